@@ -0,0 +1,122 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "simd.h"
+
+struct ArenaBlock
+{
+    ArenaBlock *next;
+};
+
+// the block header is padded so the memory after it stays aligned
+#define ARENA_BLOCK_HEADER (((sizeof(ArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN)
+
+static size_t align_up(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static unsigned char *aligned_buffer(size_t capacity)
+{
+    if (capacity == 0)
+        return NULL;
+    return (unsigned char *)simd_alloc(ARENA_ALIGN, capacity);
+}
+
+Arena *arena_new(size_t capacity)
+{
+    Arena *arena = (Arena *)calloc(1, sizeof(Arena));
+    if (!arena)
+    {
+        fprintf(stderr, "Failed to allocate memory for Arena.\n");
+        return NULL;
+    }
+
+    arena->capacity = align_up(capacity);
+    arena->data = aligned_buffer(arena->capacity);
+    if (arena->capacity && !arena->data)
+    {
+        fprintf(stderr, "Failed to allocate arena memory.\n");
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+static void arena_free_overflow(Arena *arena)
+{
+    ArenaBlock *block = arena->overflow_blocks;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        simd_free(block);
+        block = next;
+    }
+    arena->overflow_blocks = NULL;
+    arena->overflow = 0;
+}
+
+void arena_free(Arena *arena)
+{
+    if (!arena)
+    {
+        return;
+    }
+    arena_free_overflow(arena);
+    simd_free(arena->data);
+    free(arena);
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = align_up(size);
+    if (arena->used + size <= arena->capacity)
+    {
+        void *ptr = arena->data + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+
+    // out of room, hand out a heap block for now and grow on the next reset
+    ArenaBlock *block = (ArenaBlock *)simd_alloc(ARENA_ALIGN, ARENA_BLOCK_HEADER + size);
+    if (!block)
+    {
+        fprintf(stderr, "Failed to allocate arena overflow block.\n");
+        return NULL;
+    }
+    block->next = arena->overflow_blocks;
+    arena->overflow_blocks = block;
+    arena->overflow += size;
+    return (unsigned char *)block + ARENA_BLOCK_HEADER;
+}
+
+void arena_reset(Arena *arena)
+{
+    size_t total = arena->used + arena->overflow;
+    if (total > arena->peak)
+    {
+        arena->peak = total;
+    }
+
+    if (arena->overflow_blocks)
+    {
+        arena_free_overflow(arena);
+        // grow with some headroom so a slightly bigger frame doesn't overflow again
+        size_t new_capacity = align_up(arena->peak + arena->peak / 4);
+        unsigned char *grown = aligned_buffer(new_capacity);
+        if (grown)
+        {
+            simd_free(arena->data);
+            arena->data = grown;
+            arena->capacity = new_capacity;
+        }
+        else
+        {
+            fprintf(stderr, "Failed to grow arena to %zu bytes.\n", new_capacity);
+        }
+    }
+    arena->used = 0;
+}
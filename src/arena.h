@@ -0,0 +1,35 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+    Bump allocator for per frame scratch memory.
+    Allocations just move a pointer forward and are all released together by arena_reset,
+    there is no per allocation free.
+    If a frame needs more than the arena holds, the extra comes from the heap and the arena
+    grows to that frame's total on the next reset, so steady state frames never touch malloc.
+*/
+
+#define ARENA_ALIGN 32 // enough for avx loads
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct
+{
+    unsigned char *data;
+    size_t capacity;
+    size_t used;
+    size_t overflow; // bytes handed out from the heap this frame
+    ArenaBlock *overflow_blocks;
+    size_t peak; // largest used + overflow seen
+} Arena;
+
+Arena *arena_new(size_t capacity);
+void arena_free(Arena *arena);
+// returned memory is ARENA_ALIGN aligned and not zeroed, NULL only if the heap is out
+void *arena_alloc(Arena *arena, size_t size);
+// releases everything allocated since the last reset
+void arena_reset(Arena *arena);
+
+#endif // ARENA_H
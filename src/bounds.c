@@ -0,0 +1,73 @@
+#include "bounds.h"
+
+#include <float.h>
+#include <math.h>
+
+Bounds bounds_empty(void)
+{
+    return (Bounds){
+        {FLT_MAX, FLT_MAX, FLT_MAX},
+        {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+        {0.0f, 0.0f, 0.0f},
+        -1.0f};
+}
+
+bool bounds_valid(const Bounds *bounds)
+{
+    return bounds->radius >= 0.0f;
+}
+
+static void grow_box(Bounds *bounds, const float *p)
+{
+    bounds->min.x = fminf(bounds->min.x, p[0]);
+    bounds->min.y = fminf(bounds->min.y, p[1]);
+    bounds->min.z = fminf(bounds->min.z, p[2]);
+    bounds->max.x = fmaxf(bounds->max.x, p[0]);
+    bounds->max.y = fmaxf(bounds->max.y, p[1]);
+    bounds->max.z = fmaxf(bounds->max.z, p[2]);
+}
+
+static void grow_sphere(Bounds *bounds, const float *p)
+{
+    float dx = p[0] - bounds->center.x;
+    float dy = p[1] - bounds->center.y;
+    float dz = p[2] - bounds->center.z;
+    bounds->radius = fmaxf(bounds->radius, sqrtf(dx * dx + dy * dy + dz * dz));
+}
+
+static void center_sphere(Bounds *bounds)
+{
+    bounds->center = vec3_create(
+        (bounds->min.x + bounds->max.x) * 0.5f,
+        (bounds->min.y + bounds->max.y) * 0.5f,
+        (bounds->min.z + bounds->max.z) * 0.5f);
+    bounds->radius = 0.0f;
+}
+
+// two passes, the box first so the sphere can sit on its center
+Bounds bounds_from_vertices(const SFA *vertices)
+{
+    Bounds bounds = bounds_empty();
+    int count = vertices ? vertices->length / 3 : 0;
+    if (count == 0)
+        return bounds;
+    for (int i = 0; i < count; i++)
+        grow_box(&bounds, vertices->data + i * 3);
+    center_sphere(&bounds);
+    for (int i = 0; i < count; i++)
+        grow_sphere(&bounds, vertices->data + i * 3);
+    return bounds;
+}
+
+Bounds bounds_from_indices(const SFA *vertices, const SU32A *indices)
+{
+    Bounds bounds = bounds_empty();
+    if (!vertices || !indices || indices->length == 0)
+        return bounds;
+    for (int i = 0; i < indices->length; i++)
+        grow_box(&bounds, vertices->data + indices->data[i] * 3);
+    center_sphere(&bounds);
+    for (int i = 0; i < indices->length; i++)
+        grow_sphere(&bounds, vertices->data + indices->data[i] * 3);
+    return bounds;
+}
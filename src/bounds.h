@@ -0,0 +1,27 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <stdbool.h>
+
+#include "vec3.h"
+#include "sfa.h"
+#include "su32a.h"
+
+// object space bounding volumes, the sphere is centered on the box and just fits the points
+typedef struct
+{
+    Vec3 min;
+    Vec3 max;
+    Vec3 center;
+    float radius;
+} Bounds;
+
+// min > max and a negative radius, bounds_valid says no
+Bounds bounds_empty(void);
+bool bounds_valid(const Bounds *bounds);
+
+// vertices is x y z per vertex. every vertex, or just the ones indices uses
+Bounds bounds_from_vertices(const SFA *vertices);
+Bounds bounds_from_indices(const SFA *vertices, const SU32A *indices);
+
+#endif // BOUNDS_H
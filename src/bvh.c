@@ -0,0 +1,194 @@
+#include "bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+
+//////////////////////// BUILD ////////////////////////
+
+static void box_grow(Vec3 *min, Vec3 *max, Vec3 p)
+{
+    if (p.x < min->x)
+        min->x = p.x;
+    if (p.y < min->y)
+        min->y = p.y;
+    if (p.z < min->z)
+        min->z = p.z;
+    if (p.x > max->x)
+        max->x = p.x;
+    if (p.y > max->y)
+        max->y = p.y;
+    if (p.z > max->z)
+        max->z = p.z;
+}
+
+typedef struct
+{
+    float key;
+    int id;
+} SortKey;
+
+static int compare_keys(const void *a, const void *b)
+{
+    float ka = ((const SortKey *)a)->key, kb = ((const SortKey *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static float axis_of(Vec3 v, int axis)
+{
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+// builds the subtree over order[first, first + count), keys is scratch for the split sort
+static void build_node(Bvh *bvh, SortKey *keys, int first, int count)
+{
+    int index = bvh->node_count++;
+    BvhNode *node = &bvh->nodes[index];
+    node->min = vec3_create(FLT_MAX, FLT_MAX, FLT_MAX);
+    node->max = vec3_create(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    node->first = first;
+    node->count = count;
+
+    Vec3 center_min = node->min, center_max = node->max;
+    for (int i = first; i < first + count; i++)
+    {
+        const Meshlet *meshlet = &bvh->meshlets[bvh->order[i]];
+        box_grow(&node->min, &node->max, meshlet->bounds.min);
+        box_grow(&node->min, &node->max, meshlet->bounds.max);
+        box_grow(&center_min, &center_max, meshlet->bounds.center);
+    }
+
+    if (count <= BVH_LEAF_MESHLETS)
+    {
+        node->skip = index + 1;
+        return;
+    }
+
+    // split at the median meshlet center along the longest axis of the centers
+    Vec3 extent = vec3_sub(center_max, center_min);
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+    for (int i = 0; i < count; i++)
+    {
+        int id = bvh->order[first + i];
+        keys[i] = (SortKey){axis_of(bvh->meshlets[id].bounds.center, axis), id};
+    }
+    qsort(keys, count, sizeof(SortKey), compare_keys);
+    for (int i = 0; i < count; i++)
+        bvh->order[first + i] = keys[i].id;
+
+    int half = count / 2;
+    build_node(bvh, keys, first, half);
+    build_node(bvh, keys, first + half, count - half);
+    // both children are laid out now, the subtree ends here
+    node->skip = bvh->node_count;
+}
+
+Bvh *bvh_new(const SFA *vertices, const Shape *shapes, int shape_count)
+{
+    Bvh *bvh = (Bvh *)calloc(1, sizeof(Bvh));
+    if (!bvh)
+    {
+        fprintf(stderr, "Failed to allocate BVH.\n");
+        return NULL;
+    }
+
+    int count = 0;
+    for (int s = 0; s < shape_count; s++)
+        count += meshlet_count(shapes[s].vertex_indices);
+    if (!vertices || count == 0)
+        return bvh;
+
+    bvh->meshlets = (Meshlet *)malloc(sizeof(Meshlet) * count);
+    bvh->order = (int *)malloc(sizeof(int) * count);
+    // a binary tree over n leaves or fewer has at most 2n - 1 nodes
+    bvh->nodes = (BvhNode *)malloc(sizeof(BvhNode) * (2 * count - 1));
+    SortKey *keys = (SortKey *)malloc(sizeof(SortKey) * count);
+    if (!bvh->meshlets || !bvh->order || !bvh->nodes || !keys)
+    {
+        fprintf(stderr, "Failed to allocate BVH nodes.\n");
+        free(keys);
+        bvh_free(bvh);
+        return NULL;
+    }
+
+    for (int s = 0; s < shape_count; s++)
+        bvh->meshlet_count += meshlet_build(vertices, shapes[s].vertex_indices, s, bvh->meshlets + bvh->meshlet_count);
+    for (int i = 0; i < bvh->meshlet_count; i++)
+        bvh->order[i] = i;
+
+    build_node(bvh, keys, 0, bvh->meshlet_count);
+    free(keys);
+    return bvh;
+}
+
+void bvh_free(Bvh *bvh)
+{
+    if (bvh)
+    {
+        free(bvh->nodes);
+        free(bvh->meshlets);
+        free(bvh->order);
+        free(bvh);
+    }
+}
+
+//////////////////////// CULL ////////////////////////
+
+static int compare_ids(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+int bvh_cull(const Bvh *bvh, const Frustum *frustum, int *visible, CullStats *stats)
+{
+    int count = 0;
+    int nodes_tested = 0; // meshlet boxes in leaves count too
+    int i = 0;
+    while (i < bvh->node_count)
+    {
+        const BvhNode *node = &bvh->nodes[i];
+        FrustumTest test = FRUSTUM_INSIDE;
+        if (frustum)
+        {
+            test = frustum_test_box(frustum, node->min, node->max);
+            nodes_tested++;
+        }
+
+        if (test == FRUSTUM_OUTSIDE)
+        {
+            i = node->skip;
+            continue;
+        }
+        // all of it inside: take every meshlet under it without looking at the children
+        if (test == FRUSTUM_INSIDE)
+        {
+            for (int c = node->first; c < node->first + node->count; c++)
+                visible[count++] = bvh->order[c];
+            i = node->skip;
+            continue;
+        }
+        // a leaf poking out of the frustum, its meshlets get their own boxes tested
+        if (node->skip == i + 1)
+        {
+            for (int c = node->first; c < node->first + node->count; c++)
+            {
+                const Meshlet *meshlet = &bvh->meshlets[bvh->order[c]];
+                nodes_tested++;
+                if (frustum_test_box(frustum, meshlet->bounds.min, meshlet->bounds.max) != FRUSTUM_OUTSIDE)
+                    visible[count++] = bvh->order[c];
+            }
+            i = node->skip;
+            continue;
+        }
+        i++;
+    }
+
+    qsort(visible, count, sizeof(int), compare_ids);
+    if (stats)
+    {
+        stats->nodes_tested += nodes_tested;
+        stats->meshlets_tested += bvh->meshlet_count;
+        stats->meshlets_culled += bvh->meshlet_count - count;
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdbool.h>
+
+#include "vec3.h"
+#include "sfa.h"
+#include "shape.h"
+#include "frustum.h"
+#include "meshlet.h"
+
+/*
+    Bounding volume hierarchy over one model's geometry, for culling whole pieces at once.
+    Every shape gets cut into meshlets (see meshlet.h), and the tree is built top down
+    over the meshlets with median splits on the longest axis.
+    Nodes sit in one array in depth first order: a node's first child is the next node and
+    skip is where its subtree ends, so the culling walk is a single forward pass with no stack,
+    jumping over every subtree that's outside or completely inside the frustum.
+*/
+
+#define BVH_LEAF_MESHLETS 2
+
+typedef struct
+{
+    Vec3 min, max;
+    int first; // subtree covers order[first .. first + count)
+    int count;
+    int skip; // next node after this subtree, a leaf is a node whose skip is the next index
+} BvhNode;
+
+typedef struct
+{
+    BvhNode *nodes;
+    int node_count;
+
+    // shape by shape, faces in order
+    Meshlet *meshlets;
+    int meshlet_count;
+    // meshlet ids in tree order
+    int *order;
+} Bvh;
+
+// vertices is x y z per vertex and the shapes' vertex_indices point into it
+Bvh *bvh_new(const SFA *vertices, const Shape *shapes, int shape_count);
+void bvh_free(Bvh *bvh);
+
+// writes the ids of the meshlets that may be on screen to visible, sorted so shapes and faces come in order.
+// visible needs room for meshlet_count ids. a NULL frustum lets everything through
+int bvh_cull(const Bvh *bvh, const Frustum *frustum, int *visible, CullStats *stats);
+
+#endif // BVH_H
@@ -0,0 +1,92 @@
+#include "clip.h"
+
+#include "vertex_stream.h"
+
+typedef enum
+{
+    PLANE_NEAR,
+    PLANE_GUARD_LEFT,
+    PLANE_GUARD_RIGHT,
+    PLANE_GUARD_BOTTOM,
+    PLANE_GUARD_TOP,
+} ClipPlane;
+
+// signed distance, inside is >= 0
+static float plane_distance(const ClipVertex *v, ClipPlane plane)
+{
+    float guard = CLIP_GUARD_BAND * v->w;
+    switch (plane)
+    {
+    case PLANE_NEAR:
+        return v->z + v->w;
+    case PLANE_GUARD_LEFT:
+        return guard + v->x;
+    case PLANE_GUARD_RIGHT:
+        return guard - v->x;
+    case PLANE_GUARD_BOTTOM:
+        return guard + v->y;
+    default:
+        return guard - v->y;
+    }
+}
+
+static ClipVertex lerp_vertex(const ClipVertex *a, const ClipVertex *b, float t)
+{
+    return (ClipVertex){
+        a->x + (b->x - a->x) * t,
+        a->y + (b->y - a->y) * t,
+        a->z + (b->z - a->z) * t,
+        a->w + (b->w - a->w) * t,
+        a->u + (b->u - a->u) * t,
+        a->v + (b->v - a->v) * t,
+    };
+}
+
+// one sutherland-hodgman pass, returns the new vertex count
+static int clip_polygon(const ClipVertex *in, int count, ClipVertex *out, ClipPlane plane)
+{
+    int out_count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const ClipVertex *a = &in[i];
+        const ClipVertex *b = &in[(i + 1) % count];
+        float da = plane_distance(a, plane);
+        float db = plane_distance(b, plane);
+        if (da >= 0.0f)
+        {
+            out[out_count++] = *a;
+        }
+        // crossing, always interpolate from the inside vertex so shared edges clip the same way
+        if ((da >= 0.0f) != (db >= 0.0f))
+        {
+            out[out_count++] = da >= 0.0f ? lerp_vertex(a, b, da / (da - db)) : lerp_vertex(b, a, db / (db - da));
+        }
+    }
+    return out_count;
+}
+
+int clip_triangle(const ClipVertex in[3], ClipVertex out[CLIP_MAX_VERTS], bool guard_band)
+{
+    ClipVertex scratch[CLIP_MAX_VERTS];
+    int count = clip_polygon(in, 3, out, PLANE_NEAR);
+    if (!guard_band)
+        return count;
+
+    // ping pong between the two buffers, four passes ends back in out
+    for (ClipPlane plane = PLANE_GUARD_LEFT; plane <= PLANE_GUARD_TOP && count >= 3; plane += 2)
+    {
+        count = clip_polygon(out, count, scratch, plane);
+        count = clip_polygon(scratch, count, out, plane + 1);
+    }
+    return count;
+}
+
+Vec2 clip_to_screen(const ClipVertex *v, int screen_width, int screen_height)
+{
+    float ndc_x = v->x / v->w;
+    float ndc_y = v->y / v->w;
+    return (Vec2){
+        (ndc_x * 0.5f + 0.5f) * (float)screen_width,
+        (1.0f - (ndc_y * 0.5f + 0.5f)) * (float)screen_height, // Y-axis inverted
+    };
+}
@@ -0,0 +1,33 @@
+#ifndef CLIP_H
+#define CLIP_H
+
+#include <stdbool.h>
+
+#include "vec2.h"
+
+/*
+    Homogeneous clipping for the few triangles the vertex outcodes can't settle.
+    Triangles inside the guard band go straight to the rasterizer and its scissor does the
+    screen edges. Only triangles crossing the near plane (or poking out of the guard band,
+    which only happens near the camera) come through here, get Sutherland-Hodgman clipped
+    in clip space and come back as a convex polygon to fan out.
+*/
+
+// a triangle gains at most one vertex per plane: near + 4 guard band planes
+#define CLIP_MAX_VERTS (3 + 5)
+
+typedef struct
+{
+    float x, y, z, w; // clip space
+    float u, v;       // carried along and interpolated with the position
+} ClipVertex;
+
+// clips against the near plane, and the guard band planes too if guard_band is true.
+// returns the vertex count of the polygon left in out, less than 3 means nothing is left
+int clip_triangle(const ClipVertex in[3], ClipVertex out[CLIP_MAX_VERTS], bool guard_band);
+
+// perspective divide + viewport like vertex_stream_project, v must be in front of the near plane.
+// depth is clip z
+Vec2 clip_to_screen(const ClipVertex *v, int screen_width, int screen_height);
+
+#endif // CLIP_H
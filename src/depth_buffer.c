@@ -0,0 +1,124 @@
+#include "depth_buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+
+DepthBuffer *depth_buffer_new(int width, int height, DepthFormat format)
+{
+    DepthBuffer *db = (DepthBuffer *)calloc(1, sizeof(DepthBuffer));
+    if (!db)
+    {
+        fprintf(stderr, "Failed to allocate memory for DepthBuffer.\n");
+        return NULL;
+    }
+
+    db->width = width;
+    db->height = height;
+    db->stride = (width + DEPTH_ROW_ALIGN - 1) / DEPTH_ROW_ALIGN * DEPTH_ROW_ALIGN;
+    db->format = format;
+    db->data = simd_alloc(64, (size_t)db->stride * height * depth_format_size(format));
+    if (!db->data)
+    {
+        fprintf(stderr, "Failed to allocate %s depth buffer.\n", depth_format_name(format));
+        free(db);
+        return NULL;
+    }
+
+    depth_buffer_clear(db);
+    return db;
+}
+
+void depth_buffer_free(DepthBuffer *db)
+{
+    if (!db)
+    {
+        return;
+    }
+    simd_free(db->data);
+    free(db);
+}
+
+void depth_buffer_clear(DepthBuffer *db)
+{
+    // the padding too, so nothing a whole vector load picks up past the row end is garbage
+    int count = db->stride * db->height;
+    switch (db->format)
+    {
+    case DEPTH_FORMAT_U16:
+        for (int i = 0; i < count; i++)
+            ((uint16_t *)db->data)[i] = DEPTH_U16_CLEARED;
+        break;
+    case DEPTH_FORMAT_U24:
+        for (int i = 0; i < count; i++)
+            ((uint32_t *)db->data)[i] = DEPTH_U24_CLEARED;
+        break;
+    default:
+        for (int i = 0; i < count; i++)
+            ((float *)db->data)[i] = FLT_MAX;
+        break;
+    }
+}
+
+const char *depth_format_name(DepthFormat format)
+{
+    switch (format)
+    {
+    case DEPTH_FORMAT_U16:
+        return "u16";
+    case DEPTH_FORMAT_U24:
+        return "u24";
+    default:
+        return "f32";
+    }
+}
+
+bool depth_format_from_name(const char *name, DepthFormat *format)
+{
+    for (int i = 0; i < DEPTH_FORMAT_COUNT; i++)
+    {
+        if (strcmp(name, depth_format_name((DepthFormat)i)) == 0)
+        {
+            *format = (DepthFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t depth_format_cleared(DepthFormat format)
+{
+    return format == DEPTH_FORMAT_U16 ? DEPTH_U16_CLEARED : DEPTH_U24_CLEARED;
+}
+
+float depth_buffer_encode(const DepthBuffer *db, float z)
+{
+    if (db->format == DEPTH_FORMAT_F32)
+        return z;
+    // in doubles so 24 bits come out monotonic, it's once per triangle.
+    // anything at or behind the camera (clipped triangles can reach a little past it) is 0
+    double unorm = z > 0.0f ? 1.0 - DEPTH_UNORM_HALF / ((double)z + DEPTH_UNORM_HALF) : 0.0;
+    uint32_t cleared = depth_format_cleared(db->format);
+    double value = unorm * (double)cleared + 0.5;
+    // the cleared value is kept for pixels nothing was drawn on
+    return value >= (double)(cleared - 1) ? (float)(cleared - 1) : (float)(uint32_t)value;
+}
+
+float depth_buffer_get(const DepthBuffer *db, int x, int y)
+{
+    if (x < 0 || x >= db->width || y < 0 || y >= db->height)
+    {
+        return FLT_MAX;
+    }
+    const void *row = depth_buffer_row(db, y);
+    if (depth_cleared(row, x, db->format))
+        return FLT_MAX;
+    if (db->format == DEPTH_FORMAT_F32)
+        return ((const float *)row)[x];
+
+    uint32_t value = db->format == DEPTH_FORMAT_U16 ? ((const uint16_t *)row)[x] : ((const uint32_t *)row)[x];
+    double unorm = (double)value / (double)depth_format_cleared(db->format);
+    return (float)(DEPTH_UNORM_HALF * unorm / (1.0 - unorm));
+}
@@ -0,0 +1,109 @@
+#ifndef DEPTH_BUFFER_H
+#define DEPTH_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <float.h>
+
+/*
+    The z buffer, stored in one of a few formats picked when it gets made.
+    Everything outside still deals in clip z (the flat per triangle depth triangle setup gives),
+    the raster entry points turn it into what the buffer stores once per triangle with
+    depth_buffer_encode, and the kernels are compiled once per format so the per pixel test
+    is one compare of the stored type.
+
+    The encoded value is passed around as a float whatever the format: 16 and 24 bit integers
+    fit in a float exactly, so hi-z keeps its float blocks in the same units as the buffer
+    and the z < z_buffer test reads the same on both.
+
+    DEPTH_FORMAT_F32  clip z as is. clip z is linear in distance, so its float steps already
+                      grow with distance the way a reversed float buffer's would.
+    DEPTH_FORMAT_U16  half the bytes of the float one. unorm z / (z + DEPTH_UNORM_HALF), which
+                      keeps the steps small up close and still reaches any distance
+    DEPTH_FORMAT_U24  the same curve with 24 bits, in 32 bit words
+
+    An empty pixel holds the format's cleared value, and nothing drawn ever encodes to it.
+*/
+
+typedef enum
+{
+    DEPTH_FORMAT_F32,
+    DEPTH_FORMAT_U16,
+    DEPTH_FORMAT_U24,
+    DEPTH_FORMAT_COUNT,
+} DepthFormat;
+
+// clip z the unorm formats put half way through their range
+#define DEPTH_UNORM_HALF 100.0f
+#define DEPTH_U16_CLEARED 0xFFFFu
+#define DEPTH_U24_CLEARED 0xFFFFFFu
+
+// rows are padded to a multiple of this many pixels, so simd kernels can load and store whole
+// vectors up to the end of a row without leaving it
+#define DEPTH_ROW_ALIGN 16
+
+typedef struct
+{
+    int width;
+    int height;
+    int stride; // pixels from one row to the next
+    DepthFormat format;
+    void *data; // stride * height values of depth_format_size(format) bytes
+} DepthBuffer;
+
+DepthBuffer *depth_buffer_new(int width, int height, DepthFormat format);
+void depth_buffer_free(DepthBuffer *db);
+// every pixel back to the cleared value
+void depth_buffer_clear(DepthBuffer *db);
+
+const char *depth_format_name(DepthFormat format);
+// the format depth_format_name gives name for, false if there is none
+bool depth_format_from_name(const char *name, DepthFormat *format);
+
+// bytes per pixel
+static inline int depth_format_size(DepthFormat format)
+{
+    return format == DEPTH_FORMAT_U16 ? 2 : 4;
+}
+
+// clip z to the stored value, see the comment at the top
+float depth_buffer_encode(const DepthBuffer *db, float z);
+// the stored value at (x, y) back to clip z, FLT_MAX where nothing was drawn. for debug views
+float depth_buffer_get(const DepthBuffer *db, int x, int y);
+
+static inline void *depth_buffer_row(const DepthBuffer *db, int y)
+{
+    return (char *)db->data + (size_t)y * (size_t)db->stride * (size_t)depth_format_size(db->format);
+}
+
+// the per pixel test and write for the scalar loops, z is encoded and format a constant in each kernel
+static inline bool depth_test(const void *z_row, int x, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        return (uint32_t)z < ((const uint16_t *)z_row)[x];
+    if (format == DEPTH_FORMAT_U24)
+        return (uint32_t)z < ((const uint32_t *)z_row)[x];
+    return z < ((const float *)z_row)[x];
+}
+
+static inline void depth_write(void *z_row, int x, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        ((uint16_t *)z_row)[x] = (uint16_t)z;
+    else if (format == DEPTH_FORMAT_U24)
+        ((uint32_t *)z_row)[x] = (uint32_t)z;
+    else
+        ((float *)z_row)[x] = z;
+}
+
+static inline bool depth_cleared(const void *z_row, int x, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        return ((const uint16_t *)z_row)[x] == DEPTH_U16_CLEARED;
+    if (format == DEPTH_FORMAT_U24)
+        return ((const uint32_t *)z_row)[x] == DEPTH_U24_CLEARED;
+    return ((const float *)z_row)[x] == FLT_MAX;
+}
+
+#endif // DEPTH_BUFFER_H
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stdio.h>
 
 #include "globals.h"
 #include "draw.h"
@@ -15,104 +16,88 @@
 #include "mesh.h"
 #include "mat4.h"
 #include "projection.h"
-#include "f_texture.h"
+#include "depth_buffer.h"
 #include "light.h"
+#include "vertex_cache.h"
+#include "triangle_setup.h"
+#include "frustum.h"
+#include "bvh.h"
+#include "meshlet.h"
+#include "model_lod.h"
+#include "occlusion.h"
+#include "span.h"
+
+// faces [first_face, end_face) of one level of a shape, and the vertices they use
+typedef struct
+{
+    int shape;
+    int level;
+    int first_face;
+    int end_face;
+    int vertex_first;
+    int vertex_end;
+} DrawRun;
+
+// what got decided for a shape before any of it is drawn
+typedef struct
+{
+    int level;
+    bool occluder; // went into the occlusion buffer, so it never gets tested against it
+} ShapeDraw;
 
 void draw_mesh(
     Texture *pb,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
+    RenderContext *render_context,
 
     State *state,
     Texture *texture,
-    SFA *vertices,
+    const VertexCache *vertex_cache,
     SU32A *indices,
+    int first_face,
+    int end_face,
     SFA *texcoords,
     SU32A *texcoord_indices,
-
-    Vec3 pos,
-    Vec3 rot,
-    Vec3 scale)
+    const Material *material)
 {
-
-    Mat4 model = mat4_create_model(pos, rot, scale);
-    SFA *model_transformed_vertices = sfa_transform_vertices(vertices, &model);
-    // calculate normals
-    // vertices are still in x y z x y z x y z
-    int num_faces = indices->length / 3;
-    SFA *normals = sfa_new(num_faces * 3);
-    for (int face = 0; face < num_faces; face++)
+    // the setup list is frame scratch, it goes away when main resets the arena
+    SetupList triangles;
+    if (!triangle_setup(
+            &triangles,
+            render_context->frame_arena,
+            vertex_cache,
+            indices,
+            first_face,
+            end_face,
+            texcoords,
+            texcoord_indices,
+            material->cull_mode,
+            &render_context->setup_stats))
     {
-        int idx1 = indices->data[face * 3];
-        int idx2 = indices->data[face * 3 + 1];
-        int idx3 = indices->data[face * 3 + 2];
-
-        Vec3 p1 = vec3_create(
-            model_transformed_vertices->data[idx1 * 4],
-            model_transformed_vertices->data[idx1 * 4 + 1],
-            model_transformed_vertices->data[idx1 * 4 + 2]);
-        Vec3 p2 = vec3_create(
-            model_transformed_vertices->data[idx2 * 4],
-            model_transformed_vertices->data[idx2 * 4 + 1],
-            model_transformed_vertices->data[idx2 * 4 + 2]);
-        Vec3 p3 = vec3_create(
-            model_transformed_vertices->data[idx3 * 4],
-            model_transformed_vertices->data[idx3 * 4 + 1],
-            model_transformed_vertices->data[idx3 * 4 + 2]);
-
-        Vec3 normal = vec3_cross(vec3_sub(p2, p1), vec3_sub(p3, p1));
-        normal = vec3_normalize(normal);
-
-        normals->data[face] = normal.x;
-        normals->data[face + 1] = normal.y;
-        normals->data[face + 2] = normal.z;
+        return;
     }
 
-    Mat4 vp = mat4_create_vp(
-        state->camera_pos, state->camera_target, state->camera_up,
-        // degrees_to_radians(90.0), (float)pb->width / (float)pb->height, 0.1f, 100.0f);
-        degrees_to_radians(90.0), (float)pb->width / (float)pb->height, 0.1f, 100.0f);
-
-    Mat4 mvp = mat4_multiply(vp, model);
-
-    SFA *transformed_vertices // x y z w
-        = sfa_transform_vertices(vertices, &mvp);
-
-    perspective_divide(transformed_vertices); // Implement perspective_divide
-
-    // Map to screen coordinates with camera space distance
-    SFA *screen_coords // x y depth
-        = sfa_new(transformed_vertices->length / 4 * 3);
-    map_to_screen_keep_z(transformed_vertices, screen_coords, pb->width, pb->height);
-
-    // calculate cam dir
-    Vec3 cam_dir = vec3_sub(state->camera_target, state->camera_pos);
-    cam_dir = vec3_normalize(cam_dir);
-
     draw_tris_textured(
         pb,
         texture,
         z_buffer,
-        screen_coords,
-        indices,
-        texcoords,
-        texcoord_indices,
-        normals,
-        cam_dir);
+        render_context->tile_raster,
+        &triangles,
+        material->alpha_mode,
+        material->depth_mode);
 
     // Render lines
-    // draw_tris_lines_with_depth(pb, screen_coords, indices, 0xFFFFFF09);
+    // draw_tris_lines_with_depth(pb, vertex_cache->screen, indices, 0xFFFFFF09);
+}
 
-    // Cleanup
-    sfa_free(model_transformed_vertices);
-    sfa_free(transformed_vertices);
-    sfa_free(screen_coords);
-    sfa_free(normals);
+void draw_background(Texture *background)
+{
+    draw_grid(background, ivec2_create(0, 0), ivec2_create(background->width - 1, background->height - 1), 20, COLOR_GRAY_DARK);
 }
 
-void draw(Texture *pb, FTexture *z_buffer, State *state, Assets *assets)
+void draw(Texture *pb, DepthBuffer *z_buffer, State *state, Assets *assets, RenderContext *render_context)
 {
     // IVec2 screen_center = ivec2_create(pb->width / 2, pb->height / 2);
-    draw_grid(pb, ivec2_create(0, 0), ivec2_create(pb->width - 1, pb->height - 1), 20, COLOR_GRAY_DARK);
 
     // every 10 frames increment earth_mft
     if (state->frame_count % 4 == 0)
@@ -121,6 +106,12 @@ void draw(Texture *pb, FTexture *z_buffer, State *state, Assets *assets)
     }
 
     float scalef = 50.0;
+    Mat4 vp = mat4_create_vp(
+        state->camera_pos, state->camera_target, state->camera_up,
+        // degrees_to_radians(90.0), (float)pb->width / (float)pb->height, 0.1f, 100.0f);
+        degrees_to_radians(90.0), (float)pb->width / (float)pb->height, 0.1f, 100.0f);
+    VertexCache vertex_cache;
+
     // Model *model = model_manager_get_model(assets->model_manager, "gba.obj");
     // Texture *texture = texture_manager_get(assets->texture_manager, "gba.png");
     // Shape *shape = model_get_shape(model, "gba");
@@ -135,21 +126,25 @@ void draw(Texture *pb, FTexture *z_buffer, State *state, Assets *assets)
     // float y_angle = state->frame_count * 0.01 - 0.3;
     // // float y_angle = radians_to_degrees(90.0);
     // float z_angle = 0.0;
+    // Mat4 gba_model = mat4_create_model(
+    //     vec3_create(x_pos, y_pos, z_pos),       // position
+    //     vec3_create(x_angle, y_angle, z_angle), // rotation
+    //     vec3_create(scalef, scalef, scalef));   // scale
+    // vertex_cache_build(&vertex_cache, render_context->frame_arena, model->mesh->positions, &gba_model, &vp, pb->width, pb->height);
     // draw_mesh(
     //     pb,
     //     z_buffer,
+    //     render_context,
 
     //     state,
     //     texture,
-    //     model->mesh->vertices,
+    //     &vertex_cache,
     //     shape->vertex_indices,
+    //     0,
+    //     shape->vertex_indices->length / 3,
     //     model->mesh->texcoords,
     //     shape->texcoord_indices,
-
-    //     vec3_create(x_pos, y_pos, z_pos),       // position
-    //     vec3_create(x_angle, y_angle, z_angle), // rotation
-    //     vec3_create(scalef, scalef, scalef)     // scale
-    // );
+    //     material);
 
     // draw peaches_castle.obj
     // we have to loop through all the shapes in the model
@@ -159,28 +154,187 @@ void draw(Texture *pb, FTexture *z_buffer, State *state, Assets *assets)
     Texture *texture;
     model = model_manager_get_model(assets->model_manager, "peaches_castle.obj");
     MaterialLibrary *material_library = material_manager_get_library(assets->material_manager, model->material_library_name);
-    for (int i = 0; i < model->shape_count; i++)
+
+    // every shape shares the model's vertex pool, transform it once for all of them
+    Mat4 model_matrix = mat4_create_model(
+        vec3_create(0.0, 0.0, 0.0),                       // position
+        vec3_create(0.0, degrees_to_radians(180.0), 0.0), // rotation
+        vec3_create(scalef, scalef, scalef));             // scale
+    if (!vertex_cache_begin(&vertex_cache, render_context->frame_arena, model->mesh->positions, &model_matrix, &vp, pb->width, pb->height))
+    {
+        return;
+    }
+
+    // the bvh throws out everything off screen before the transform and setup,
+    // only the vertex ranges of the meshlets left get projected
+    CullStats *cull_stats = &render_context->cull_stats;
+    Bvh *bvh = model->bvh;
+    Frustum frustum = frustum_from_matrix(&vertex_cache.mvp);
+    int *visible = (int *)arena_alloc(render_context->frame_arena, sizeof(int) * (bvh->meshlet_count + 1));
+    if (!visible)
+    {
+        fprintf(stderr, "Failed to allocate visible meshlets.\n");
+        return;
+    }
+    int visible_count = bvh_cull(bvh, USE_FRUSTUM_CULLING ? &frustum : NULL, visible, cull_stats);
+    // the normal cones get tested against the camera in the model's own space
+    Vec3 camera = mat4_multiply_vec3(mat4_inverse(model_matrix), state->camera_pos);
+
+    // pick the lods first, the occluders have to go in at the level they get drawn with
+    ShapeDraw *shape_draws = (ShapeDraw *)arena_alloc(render_context->frame_arena, sizeof(ShapeDraw) * model->shape_count);
+    // what's left turns into runs of faces, one per shape drawn at a lod or one per block of back to back meshlets
+    DrawRun *runs = (DrawRun *)arena_alloc(render_context->frame_arena, sizeof(DrawRun) * (visible_count + 1));
+    if (!shape_draws || !runs)
+    {
+        fprintf(stderr, "Failed to allocate draw runs.\n");
+        return;
+    }
+    OcclusionBuffer *occlusion = render_context->occlusion;
+    for (int v = 0; v < visible_count;)
+    {
+        int shape_index = bvh->meshlets[visible[v]].shape;
+        shape = &model->shapes[shape_index];
+        while (v < visible_count && bvh->meshlets[visible[v]].shape == shape_index)
+            v++;
+
+        ShapeDraw *shape_draw = &shape_draws[shape_index];
+        *shape_draw = (ShapeDraw){0, false};
+        if (!(USE_MESH_LODS && shape->lod_count > 1) && !occlusion)
+            continue;
+        float radius_px = frustum_projected_radius(&vertex_cache.mvp, &shape->bounds, pb->height);
+        if (USE_MESH_LODS && shape->lod_count > 1)
+            shape_draw->level = model_lod_pick(shape, radius_px, LOD_ERROR_PIXELS);
+        if (!occlusion || radius_px < OCCLUDER_MIN_RADIUS_PX)
+            continue;
+
+        // only shapes that put every covered pixel in the z buffer can hide anything
+        Material *material = material_library_get_material(material_library, shape->material_name);
+        texture = texture_manager_get(assets->texture_manager, material->diffuse_map);
+        if (!texture || material->depth_mode != DEPTH_WRITE || span_resolve_alpha(material->alpha_mode, texture) != ALPHA_OPAQUE)
+            continue;
+        const ShapeLod *lod = &shape->lods[shape_draw->level];
+        cull_stats->vertices_projected += vertex_cache_project(&vertex_cache, lod->vertex_first, lod->vertex_end);
+        cull_stats->occluder_triangles += occlusion_buffer_draw(occlusion, &vertex_cache, lod->indices, 0, lod->indices->length / 3, material->cull_mode);
+        cull_stats->occluders++;
+        shape_draw->occluder = true;
+    }
+
+    int run_count = 0;
+    int shapes_drawn = 0;
+    int v = 0;
+    while (v < visible_count)
     {
-        shape = &model->shapes[i];
+        int shape_index = bvh->meshlets[visible[v]].shape;
+        shape = &model->shapes[shape_index];
+        CullMode cull_mode = material_library_get_material(material_library, shape->material_name)->cull_mode;
+        const ShapeDraw *shape_draw = &shape_draws[shape_index];
+        // everything but the occluders themselves gets checked against them, the whole shape first
+        bool test_occlusion = occlusion && !shape_draw->occluder;
+        if (test_occlusion && occlusion_buffer_box_occluded(occlusion, &vertex_cache.mvp, shape->bounds.min, shape->bounds.max))
+        {
+            cull_stats->shapes_occluded++;
+            while (v < visible_count && bvh->meshlets[visible[v]].shape == shape_index)
+                v++;
+            continue;
+        }
+
+        int level = shape_draw->level;
+        if (level > 0)
+        {
+            const ShapeLod *lod = &shape->lods[level];
+            runs[run_count++] = (DrawRun){shape_index, level, 0, lod->indices->length / 3, lod->vertex_first, lod->vertex_end};
+            cull_stats->shapes_simplified++;
+            while (v < visible_count && bvh->meshlets[visible[v]].shape == shape_index)
+                v++;
+            continue;
+        }
+
+        while (v < visible_count && bvh->meshlets[visible[v]].shape == shape_index)
+        {
+            const Meshlet *meshlet = &bvh->meshlets[visible[v]];
+            v++;
+            if (USE_MESHLET_CONE_CULLING && meshlet_backfacing(meshlet, camera, cull_mode))
+            {
+                cull_stats->meshlets_backfacing++;
+                continue;
+            }
+            if (test_occlusion && occlusion_buffer_box_occluded(occlusion, &vertex_cache.mvp, meshlet->bounds.min, meshlet->bounds.max))
+            {
+                cull_stats->meshlets_occluded++;
+                continue;
+            }
+            // back to back meshlets of a shape are one run of faces
+            if (run_count > 0 && runs[run_count - 1].shape == shape_index && runs[run_count - 1].level == 0 &&
+                runs[run_count - 1].end_face == meshlet->first_face)
+            {
+                DrawRun *run = &runs[run_count - 1];
+                run->end_face = meshlet->end_face;
+                run->vertex_first = meshlet->vertex_first < run->vertex_first ? meshlet->vertex_first : run->vertex_first;
+                run->vertex_end = meshlet->vertex_end > run->vertex_end ? meshlet->vertex_end : run->vertex_end;
+                continue;
+            }
+            runs[run_count++] = (DrawRun){shape_index, 0, meshlet->first_face, meshlet->end_face, meshlet->vertex_first, meshlet->vertex_end};
+        }
+    }
+
+    // runs come in shape order, so neighbouring ones mostly extend one range of vertices
+    int range_first = 0, range_end = 0;
+    for (int r = 0; r < run_count; r++)
+    {
+        const DrawRun *run = &runs[r];
+        // ranges get padded out to VERTEX_STREAM_PAD anyway, a gap smaller than that is cheaper to project through
+        if (range_end > range_first && (run->vertex_first > range_end + VERTEX_STREAM_PAD || run->vertex_end < range_first))
+        {
+            cull_stats->vertices_projected += vertex_cache_project(&vertex_cache, range_first, range_end);
+            range_first = range_end = 0;
+        }
+        if (range_end > range_first)
+        {
+            range_first = run->vertex_first < range_first ? run->vertex_first : range_first;
+            range_end = run->vertex_end > range_end ? run->vertex_end : range_end;
+        }
+        else
+        {
+            range_first = run->vertex_first;
+            range_end = run->vertex_end;
+        }
+    }
+    cull_stats->vertices_projected += vertex_cache_project(&vertex_cache, range_first, range_end);
+
+    TileRaster *tile_raster = render_context->tile_raster;
+    tile_raster_begin(tile_raster, pb, z_buffer, render_context->hi_z);
+    for (int r = 0; r < run_count; r++)
+    {
+        const DrawRun *run = &runs[r];
+        shape = &model->shapes[run->shape];
+        SU32A *indices = shape->lods[run->level].indices;
         Material *material = material_library_get_material(material_library, shape->material_name);
         // print the diffuse_map name
         texture = texture_manager_get(assets->texture_manager, material->diffuse_map);
+        if (r == 0 || runs[r - 1].shape != run->shape)
+        {
+            tile_raster_begin_shape(tile_raster, indices->length / 3);
+            shapes_drawn++;
+        }
         draw_mesh(
             pb,
             z_buffer,
+            render_context,
 
             state,
             texture,
-            model->mesh->vertices,
-            shape->vertex_indices,
+            &vertex_cache,
+            indices,
+            run->first_face,
+            run->end_face,
             model->mesh->texcoords,
             shape->texcoord_indices,
-
-            vec3_create(0.0, 0.0, 0.0),                       // position
-            vec3_create(0.0, degrees_to_radians(180.0), 0.0), // rotation
-            vec3_create(scalef, scalef, scalef)               // scale
-        );
+            material);
     }
+    cull_stats->shapes_tested += model->shape_count;
+    cull_stats->shapes_culled += model->shape_count - shapes_drawn;
+    // the shapes were only binned so far, rasterize them across all cores
+    tile_raster_flush(tile_raster);
 
     // Vec2 mouse_pos = ivec2_to_vec2(get_mouse_pos());
     // draw_cursor(pb, mouse_pos.x, mouse_pos.y, 10, 0xFFFFFFFF);
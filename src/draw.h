@@ -7,7 +7,11 @@
 #include "draw_lib.h"
 #include "texture.h"
 #include "assets.h"
-#include "f_texture.h"
+#include "depth_buffer.h"
+#include "render_context.h"
 
-void draw(Texture *pb, FTexture *z_buffer, State *state, Assets *assets);
+// what the frame clears to (see tile_raster_clear), it doesn't change so it's only drawn once
+void draw_background(Texture *background);
+// pb, z_buffer and the hi-z have to be cleared with tile_raster_clear first
+void draw(Texture *pb, DepthBuffer *z_buffer, State *state, Assets *assets, RenderContext *render_context);
 #endif
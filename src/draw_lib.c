@@ -2,7 +2,10 @@
 #include "primitives.h"
 #include "utils.h"
 #include "vec2.h"
-#include "f_texture.h"
+#include "depth_buffer.h"
+#include "globals.h"
+#include "raster_halfspace.h"
+#include "span.h"
 
 void draw_line(Texture *pb, int x0, int y0, int x1, int y1, uint32_t color)
 {
@@ -53,12 +56,15 @@ void draw_lines(Texture *pb, SFA *points, uint32_t color)
 
 void draw_rect(Texture *pb, int x, int y, int w, int h, uint32_t color)
 {
-    for (int i = x; i < x + w; i++)
+    // clipped once up front so the rows can go through the unchecked span writer
+    int x0 = imax(x, 0);
+    int x1 = imin(x + w, pb->width) - 1;
+    int y0 = imax(y, 0);
+    int y1 = imin(y + h, pb->height) - 1;
+    FlatSpanFn span_fn = span_flat((color & 0xFF) == 255 ? ALPHA_OPAQUE : ALPHA_BLEND, DEPTH_OFF, DEPTH_FORMAT_F32);
+    for (int j = y0; j <= y1; j++)
     {
-        for (int j = y; j < y + h; j++)
-        {
-            texture_set_alpha(pb, i, j, color);
-        }
+        span_fn(pb->pixels + j * pb->stride, NULL, x0, x1, color, 0.0f);
     }
 }
 
@@ -77,52 +83,10 @@ void draw_triangle_lines(Texture *pb, Triangle t, uint32_t color)
     draw_line(pb, t.p3.x, t.p3.y, t.p1.x, t.p1.y, color);
 }
 
-static inline int edge_function(IVec2 a, IVec2 b, IVec2 p)
-{
-    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
-}
-
+// half-space rasterizer, see raster_halfspace.c
 void draw_triangle(Texture *pb, Triangle t, uint32_t color)
 {
-    IVec2 p1 = vec2_to_ivec2(t.p1);
-    IVec2 p2 = vec2_to_ivec2(t.p2);
-    IVec2 p3 = vec2_to_ivec2(t.p3);
-
-    // Compute bounding box
-    int minX = imin(imin(p1.x, p2.x), p3.x);
-    int minY = imin(imin(p1.y, p2.y), p3.y);
-    int maxX = imax(imax(p1.x, p2.x), p3.x);
-    int maxY = imax(imax(p1.y, p2.y), p3.y);
-
-    // Clip against screen bounds
-    minX = imax(minX, 0);
-    minY = imax(minY, 0);
-    maxX = imin(maxX, pb->width - 1);
-    maxY = imin(maxY, pb->height - 1);
-
-    // Determine triangle orientation
-    int area = edge_function(p1, p2, p3);
-    bool clockwise = area <= 0;
-
-    IVec2 p;
-    for (p.y = minY; p.y <= maxY; p.y++)
-    {
-        for (p.x = minX; p.x <= maxX; p.x++)
-        {
-            int w1 = edge_function(p1, p2, p);
-            int w2 = edge_function(p2, p3, p);
-            int w3 = edge_function(p3, p1, p);
-
-            // If p is on or inside all edges, render pixel
-            if (clockwise)
-            {
-                if (w1 <= 0 && w2 <= 0 && w3 <= 0)
-                {
-                    texture_set_alpha(pb, p.x, p.y, color);
-                }
-            }
-        }
-    }
+    raster_halfspace_flat(pb, t, color);
 }
 
 // draw_triangle_centroid_z_per_pixel_z_check(pb, z_buffer, t, color, z);
@@ -131,54 +95,13 @@ void draw_triangle(Texture *pb, Triangle t, uint32_t color)
     if the z value of the pixel is less than the z value in the z buffer we will draw the pixel and update the z buffer
     else we will skip the pixel
 
-    can use f_texture get and set
+    can use depth_buffer_get
 */
-void draw_triangle_centroid_z_per_pixel_z_check(Texture *pb, FTexture *z_buffer, Triangle t, uint32_t color, float z)
-{
-    IVec2 p1 = vec2_to_ivec2(t.p1);
-    IVec2 p2 = vec2_to_ivec2(t.p2);
-    IVec2 p3 = vec2_to_ivec2(t.p3);
-
-    // Compute bounding box
-    int minX = imin(imin(p1.x, p2.x), p3.x);
-    int minY = imin(imin(p1.y, p2.y), p3.y);
-    int maxX = imax(imax(p1.x, p2.x), p3.x);
-    int maxY = imax(imax(p1.y, p2.y), p3.y);
-
-    // Clip against screen bounds
-    minX = imax(minX, 0);
-    minY = imax(minY, 0);
-    maxX = imin(maxX, pb->width - 1);
-    maxY = imin(maxY, pb->height - 1);
-
-    // Determine triangle orientation
-    int area = edge_function(p1, p2, p3);
-    bool clockwise = area <= 0;
-
-    IVec2 p;
-    for (p.y = minY; p.y <= maxY; p.y++)
+void draw_triangle_centroid_z_per_pixel_z_check(Texture *pb, DepthBuffer *z_buffer, Triangle t, uint32_t color, float z)
+{
+    if (z > 80.0f)
     {
-        for (p.x = minX; p.x <= maxX; p.x++)
-        {
-            int w1 = edge_function(p1, p2, p);
-            int w2 = edge_function(p2, p3, p);
-            int w3 = edge_function(p3, p1, p);
-
-            // If p is on or inside all edges, render pixel
-            if (clockwise)
-            {
-                if (w1 <= 0 && w2 <= 0 && w3 <= 0)
-                {
-                    // get z value from z buffer
-                    float z_buffer_value = f_texture_get(z_buffer, p.x, p.y);
-                    if (z > 80.0f && z < z_buffer_value)
-                    {
-                        texture_set_alpha(pb, p.x, p.y, color);
-                        f_texture_set(z_buffer, p.x, p.y, z);
-                    }
-                }
-            }
-        }
+        raster_halfspace_flat_z(pb, z_buffer, t, color, z);
     }
 }
 
@@ -220,7 +143,7 @@ void sort_verticies_by_y_and_swap_uv_indices(Vec2 *v0, Vec2 *v1, Vec2 *v2, Vec2
     }
 }
 
-void draw_triangle_scanline_constant_z(Texture *pb, FTexture *z_buffer, Triangle t, uint32_t color, float z)
+void draw_triangle_scanline_constant_z(Texture *pb, DepthBuffer *z_buffer, Triangle t, uint32_t color, float z)
 {
     Vec2 v0 = t.p1;
     Vec2 v1 = t.p2;
@@ -229,6 +152,10 @@ void draw_triangle_scanline_constant_z(Texture *pb, FTexture *z_buffer, Triangle
     // Sort vertices by Y-coordinate ascending
     sort_vertices_by_y(&v0, &v1, &v2);
 
+    // the color's alpha is the same for the whole triangle, so is the writer
+    FlatSpanFn span_fn = span_flat((color & 0xFF) == 255 ? ALPHA_OPAQUE : ALPHA_BLEND, DEPTH_WRITE, z_buffer->format);
+    float depth = depth_buffer_encode(z_buffer, z);
+
     // Compute inverse slopes
     // float inv_slope_1 = 0, inv_slope_2 = 0;
 
@@ -267,28 +194,20 @@ void draw_triangle_scanline_constant_z(Texture *pb, FTexture *z_buffer, Triangle
         if (y < 0 || y >= pb->height)
             continue;
 
-        for (int x = x_start; x <= x_end; x++)
-        {
-            // Z-buffer check and update
-            float z_buffer_value = f_texture_get(z_buffer, x, y);
-            if (z < z_buffer_value)
-            {
-                texture_set_alpha(pb, x, y, color);
-                f_texture_set(z_buffer, x, y, z);
-            }
-        }
+        span_fn(pb->pixels + y * pb->stride, depth_buffer_row(z_buffer, y), x_start, x_end, color, depth);
     }
 }
 
 void draw_triangle_scanline_constant_z_with_face_buffer(
     Texture *pb,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
     Triangle t,
     uint32_t color,
     float z,
     Texture *face_buffer,
     uint32_t face)
 {
+    float depth = depth_buffer_encode(z_buffer, z);
     Vec2 v0 = t.p1;
     Vec2 v1 = t.p2;
     Vec2 v2 = t.p3;
@@ -334,14 +253,14 @@ void draw_triangle_scanline_constant_z_with_face_buffer(
         if (y < 0 || y >= pb->height)
             continue;
 
+        void *z_row = depth_buffer_row(z_buffer, y);
         for (int x = x_start; x <= x_end; x++)
         {
             // Z-buffer check and update
-            float z_buffer_value = f_texture_get(z_buffer, x, y);
-            if (z < z_buffer_value)
+            if (depth_test(z_row, x, depth, z_buffer->format))
             {
                 texture_set_alpha(pb, x, y, color);
-                f_texture_set(z_buffer, x, y, z);
+                depth_write(z_row, x, depth, z_buffer->format);
                 texture_set(face_buffer, x, y, face);
             }
         }
@@ -352,15 +271,50 @@ void draw_triangle_scanline_constant_z_with_face_buffer(
 void draw_triangle_scanline_with_texture(
     Texture *pb,
     Texture *texture,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
+    Triangle t,
+    Triangle t_uv,
+    float z,
+    AlphaMode alpha_mode,
+    DepthMode depth_mode)
+{
+    IRect clip = {0, 0, pb->width, pb->height};
+    draw_triangle_scanline_with_texture_clipped(pb, texture, z_buffer, t, t_uv, z, alpha_mode, depth_mode, clip);
+}
+
+/*
+    same as draw_triangle_scanline_with_texture but only writes pixels inside clip.
+    the uv stepping still starts from the left edge of the screen clamped span, so a
+    triangle drawn one tile at a time comes out identical to drawing it in one go.
+    the spans step uv in fixed point and get written by the span writer picked for alpha and depth, see span.h
+*/
+void draw_triangle_scanline_with_texture_clipped(
+    Texture *pb,
+    Texture *texture,
+    DepthBuffer *z_buffer,
     Triangle t,
     Triangle t_uv,
-    float z)
+    float z,
+    AlphaMode alpha_mode,
+    DepthMode depth_mode,
+    IRect clip)
 {
     // if texture is null, return
     if (!texture)
         return;
 
+    // pick the mip level from the triangle's uv derivatives, the same way the half-space path does
+    UVSetup uvs;
+    raster_uv_setup(&uvs, t, t_uv);
+    const Texture *level = raster_uv_mip(texture, &uvs);
+    TexturedSpanFn span_fn = span_textured(span_resolve_alpha(alpha_mode, texture), depth_mode, z_buffer->format, level);
+    float depth = depth_buffer_encode(z_buffer, z);
+
+    int clip_x0 = clip.x;
+    int clip_x1 = clip.x + clip.w - 1;
+    int clip_y0 = clip.y;
+    int clip_y1 = clip.y + clip.h - 1;
+
     // Extract vertex positions
     Vec2 v0 = t.p1;
     Vec2 v1 = t.p2;
@@ -379,8 +333,10 @@ void draw_triangle_scanline_with_texture(
     if (total_height == 0.0f)
         return; // Degenerate triangle
 
-    // Rasterize the triangle using scanline approach
-    for (int y = (int)ceilf(v0.y); y <= (int)floorf(v2.y); y++)
+    // Rasterize the triangle using scanline approach, rows outside the clip are skipped
+    int y_start = imax((int)ceilf(v0.y), clip_y0);
+    int y_end = imin((int)floorf(v2.y), clip_y1);
+    for (int y = y_start; y <= y_end; y++)
     {
         bool second_half = y > v1.y || v1.y == v0.y;
         float segment_height = second_half ? (v2.y - v1.y) : (v1.y - v0.y);
@@ -413,6 +369,7 @@ void draw_triangle_scanline_with_texture(
         // Clip X coordinates to screen bounds
         int x_start = (int)ceilf(fmaxf(A.x, 0.0f));
         int x_end = (int)floorf(fminf(B.x, (float)(pb->width - 1)));
+        x_end = imin(x_end, clip_x1);
 
         if (y < 0 || y >= pb->height)
             continue; // Skip scanlines outside the screen
@@ -430,69 +387,25 @@ void draw_triangle_scanline_with_texture(
         float u = A_uv.x + (x_start - A.x) * u_step;
         float v = A_uv.y + (x_start - A.x) * v_step;
 
-        for (int x = x_start; x <= x_end; x++)
-        {
-            // Clamp UV coordinates to [0, 1] to avoid sampling outside the texture
-            // modulus the u and v values to keep them in the range [0, 1]
-            // the values right now can even be negative so we have to manually do this
-            if (u > 1.0f)
-            {
-                // lets say u is 14.2
-                // 14.2 % 1 = 0.2
-                u = u - (int)u;
-            }
-            else if (u < 0.0f)
-            {
-                // lets say u is -14.2
-                // -14.2 % 1 = 0.8
-                u = 1.0f + u - (int)u;
-            }
-
-            if (v > 1.0f)
-            {
-                v = v - (int)v;
-            }
-            else if (v < 0.0f)
-            {
-                v = 1.0f + v - (int)v;
-            }
-
-            float clamped_u = fminf(fmaxf(u, 0.0f), 1.0f);
-            float clamped_v = fminf(fmaxf(v, 0.0f), 1.0f);
-            // // invert u and v
-            clamped_u = 1.0f - clamped_u;
-            clamped_v = 1.0f - clamped_v;
-
-            // Convert UV coordinates to texture space indices
-            // print the clamped u and v
-            // printf("clamped u: %f, clamped v: %f\n", clamped_u, clamped_v);
-            // print the texture dimensions
-            // printf("texture width: %d, texture height: %d\n", texture->width, texture->height);
-            int tex_x = (int)(clamped_u * (texture->width - 1));
-            int tex_y = (int)(clamped_v * (texture->height - 1));
+        FixedSpan span = {
+            span_fixed_start(u, level->width),
+            span_fixed_start(v, level->height),
+            span_fixed_step(u_step, level->width),
+            span_fixed_step(v_step, level->height),
+        };
 
-            // Sample the texture color at (tex_x, tex_y)
-            uint32_t sampled_color = texture_get(texture, tex_x, tex_y);
-
-            // Z-buffer check and update
-            float z_buffer_value = f_texture_get(z_buffer, x, y);
-            if (z < z_buffer_value)
-            {
-                // Update the pixel color in the framebuffer
-                texture_set_alpha(pb, x, y, sampled_color);
-
-                // Update the Z-buffer with the new Z value
-                f_texture_set(z_buffer, x, y, z);
-
-                // Optionally, set the face identifier in the face buffer
-                // if (face_buffer != NULL)
-                //     texture_set(face_buffer, x, y, face);
-            }
-
-            // Increment UV coordinates for the next pixel
-            u += u_step;
-            v += v_step;
+        // left of the clip we only keep the uv stepping in sync, done in one go since it's exact in fixed point
+        if (x_start < clip_x0)
+        {
+            uint64_t skipped = (uint64_t)(clip_x0 - x_start);
+            span.s = (uint32_t)((span.s + skipped * span.ds) % ((uint64_t)level->width << 16));
+            span.t = (uint32_t)((span.t + skipped * span.dt) % ((uint64_t)level->height << 16));
+            x_start = clip_x0;
         }
+        if (x_start > x_end)
+            continue;
+
+        span_fn(pb->pixels + y * pb->stride, depth_buffer_row(z_buffer, y), level, &span, x_start, x_end, depth);
     }
 }
 
@@ -641,72 +554,32 @@ void draw_tris_with_colors(Texture *pb, SFA *vertices, SU32A *indices, SU32A *co
 }
 
 /*
-    vertices: x1a,y1a,z1a,x1b,y1b,z1b,x1c,y1c,z1c, x2a,y2a,z2a,x2b,y2b,z2b,x2c,y2c,z2c, ...
-    verticies are in groups of 3 (a,b,c) for each triangle, and each vertex has x,y in screenspace and z is cam dist
+    triangles come out of triangle_setup already culled and clipped, x,y in screenspace
 
-    for compute cost savings we will first average the z values of the 3 vertices of each triangle
+    for compute cost savings setup has already averaged the z values of the 3 vertices of each triangle
     when drawing a pixel we will sample the z buffer at that position
     if the z value of the pixel is less than the z value in the z buffer we will draw the pixel and update the z buffer
     else we will skip the pixel
 */
 void draw_tris_with_colors_and_depth(
     Texture *pb,
-    FTexture *z_buffer,
-    SFA *vertices,
-    SU32A *indices,
-    SU32A *colors)
+    DepthBuffer *z_buffer,
+    const SetupList *triangles,
+    SU32A *colors) // one per face
 {
-    for (int i = 0; i < indices->length; i += 3)
+    for (int i = 0; i < triangles->count; i++)
     {
-        int idx1 = indices->data[i];
-        int idx2 = indices->data[i + 1];
-        int idx3 = indices->data[i + 2];
-
-        Vec2 p1 = {vertices->data[idx1 * 3], vertices->data[idx1 * 3 + 1]};
-        Vec2 p2 = {vertices->data[idx2 * 3], vertices->data[idx2 * 3 + 1]};
-        Vec2 p3 = {vertices->data[idx3 * 3], vertices->data[idx3 * 3 + 1]};
-
-        // skip if all the verts are off screen
-        if (p1.x < 0 && p2.x < 0 && p3.x < 0)
-        {
-            continue;
-        }
-        if (p1.x >= pb->width && p2.x >= pb->width && p3.x >= pb->width)
-        {
-            continue;
-        }
-        if (p1.y < 0 && p2.y < 0 && p3.y < 0)
-        {
-            continue;
-        }
-        if (p1.y >= pb->height && p2.y >= pb->height && p3.y >= pb->height)
-        {
-            continue;
-        }
-
-        // skip if they are too close to the camera
-        const float near = 40.0f;
-        if (vertices->data[idx1 * 3 + 2] < near && vertices->data[idx2 * 3 + 2] < near && vertices->data[idx3 * 3 + 2] < near)
-        {
-            continue;
-        }
-
-        Triangle t = {p1, p2, p3};
-        uint32_t color = colors->data[i / 3];
-
-        // average the z values of the 3 vertices
-        float z = (vertices->data[idx1 * 3 + 2] + vertices->data[idx2 * 3 + 2] + vertices->data[idx3 * 3 + 2]) / 3.0f;
-
+        const SetupTriangle *st = &triangles->triangles[i];
         // draw the triangle
         // draw_triangle_centroid_z_per_pixel_z_check(pb, z_buffer, t, color, z);
-        draw_triangle_scanline_constant_z(pb, z_buffer, t, color, z);
+        draw_triangle_scanline_constant_z(pb, z_buffer, st->t, colors->data[st->face], st->z);
     }
 }
 
 // identical but puts the face index in the face buffer for each pixel
 void draw_tris_with_colors_and_depth_with_face_buffer(
     Texture *pb,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
     Texture *face_buffer,
     SFA *vertices,
     SU32A *indices,
@@ -759,77 +632,40 @@ void draw_tris_with_colors_and_depth_with_face_buffer(
     }
 }
 
-void draw_tris_textured(
-    Texture *pb,
-    Texture *texture,
-    FTexture *z_buffer,
-    SFA *vertices, // x,y,w,x,y,w,x,y,w
-    SU32A *indices,
-    SFA *texcoords,
-    SU32A *texcoord_indices,
-    SFA *normals, // one per face: x,y,z...
-    Vec3 cam_dir)
+static void submit_textured(
+    Texture *pb, Texture *texture, DepthBuffer *z_buffer, TileRaster *tile_raster,
+    Triangle t, Triangle t_uv, float z, AlphaMode alpha, DepthMode depth, int face)
 {
-    int num_faces = indices->length / 3;
-    for (int face = 0; face < num_faces; face += 1)
+    if (tile_raster)
     {
-        // Vec3 n1 = {normals->data[face], normals->data[face + 1], normals->data[face + 2]};
-        // // if facing away from camera skip
-        // if (vec3_dot(n1, cam_dir) > 0)
-        // {
-        //     continue;
-        // }
-
-        int idx1 = indices->data[face * 3];
-        int idx2 = indices->data[face * 3 + 1];
-        int idx3 = indices->data[face * 3 + 2];
-
-        Vec2 p1 = {vertices->data[idx1 * 3], vertices->data[idx1 * 3 + 1]};
-        Vec2 p2 = {vertices->data[idx2 * 3], vertices->data[idx2 * 3 + 1]};
-        Vec2 p3 = {vertices->data[idx3 * 3], vertices->data[idx3 * 3 + 1]};
-
-        // skip if all the verts are off screen
-        if (p1.x < 0 && p2.x < 0 && p3.x < 0)
-        {
-            continue;
-        }
-        if (p1.x >= pb->width && p2.x >= pb->width && p3.x >= pb->width)
-        {
-            continue;
-        }
-        if (p1.y < 0 && p2.y < 0 && p3.y < 0)
-        {
-            continue;
-        }
-        if (p1.y >= pb->height && p2.y >= pb->height && p3.y >= pb->height)
+        tile_raster_submit_textured(tile_raster, texture, t, t_uv, z, alpha, depth, face);
+    }
+    else
+    {
+        if (RASTER_HALFSPACE_TEXTURED && raster_halfspace_handles(texture, alpha, depth))
         {
-            continue;
+            raster_halfspace_textured(pb, texture, z_buffer, NULL, NULL, t, t_uv, z, (IRect){0, 0, pb->width, pb->height});
         }
-
-        // skip if they are too close to the camera
-        const float near = 40.0f;
-        if (vertices->data[idx1 * 3 + 2] < near && vertices->data[idx2 * 3 + 2] < near && vertices->data[idx3 * 3 + 2] < near)
+        else
         {
-            continue;
+            draw_triangle_scanline_with_texture(pb, texture, z_buffer, t, t_uv, z, alpha, depth);
         }
+    }
+}
 
-        Triangle t = {p1, p2, p3};
-
-        // get the uv coordinates for the 3 vertices
-        int uv_idx1 = texcoord_indices->data[face * 3];
-        int uv_idx2 = texcoord_indices->data[face * 3 + 1];
-        int uv_idx3 = texcoord_indices->data[face * 3 + 2];
-
-        Vec2 uv1 = {texcoords->data[uv_idx1 * 2], texcoords->data[uv_idx1 * 2 + 1]};
-        Vec2 uv2 = {texcoords->data[uv_idx2 * 2], texcoords->data[uv_idx2 * 2 + 1]};
-        Vec2 uv3 = {texcoords->data[uv_idx3 * 2], texcoords->data[uv_idx3 * 2 + 1]};
-
-        Triangle t_uv = {uv1, uv2, uv3};
-
-        // average the z values of the 3 vertices
-        float z = (vertices->data[idx1 * 3 + 2] + vertices->data[idx2 * 3 + 2] + vertices->data[idx3 * 3 + 2]) / 3.0f;
-        // draw the triangle
-        draw_triangle_scanline_with_texture(pb, texture, z_buffer, t, t_uv, z);
+void draw_tris_textured(
+    Texture *pb,
+    Texture *texture,
+    DepthBuffer *z_buffer,
+    TileRaster *tile_raster, // if not NULL the triangles are binned and drawn on tile_raster_flush
+    const SetupList *triangles,
+    AlphaMode alpha_mode,
+    DepthMode depth_mode)
+{
+    for (int i = 0; i < triangles->count; i++)
+    {
+        const SetupTriangle *st = &triangles->triangles[i];
+        submit_textured(pb, texture, z_buffer, tile_raster, st->t, st->t_uv, st->z, alpha_mode, depth_mode, st->face);
     }
 }
 
@@ -6,7 +6,10 @@
 #include "texture.h"
 #include "sfa.h"
 #include "su32a.h"
-#include "f_texture.h"
+#include "depth_buffer.h"
+#include "tile_raster.h"
+#include "triangle_setup.h"
+#include "material.h"
 
 //////////////////////// PRIMITIVE DRAWING FUNCTIONS ////////////////////////
 void draw_line(Texture *pb, int x0, int y0, int x1, int y1, uint32_t color);
@@ -29,18 +32,18 @@ void draw_tris_lines_with_depth(Texture *pb, SFA *vertices, SU32A *indices, uint
 void draw_tris_with_colors(Texture *pb, SFA *vertices, SU32A *indices, SU32A *colors);
 void draw_tris_face_numbers(Texture *pb, Texture *charmap, SFA *vertices, SU32A *indices, uint32_t size, uint32_t color);
 void draw_tris_with_colors_and_face_numbers(Texture *pb, Texture *charmap, SFA *vertices, SU32A *indices, SU32A *colors, uint32_t size, uint32_t color);
-void draw_tris_with_colors_and_depth(Texture *pb, FTexture *z_buffer, SFA *vertices, SU32A *indices, SU32A *colors);
+void draw_tris_with_colors_and_depth(Texture *pb, DepthBuffer *z_buffer, const SetupList *triangles, SU32A *colors);
 
 void draw_tris_with_colors_and_depth_with_face_buffer(
     Texture *pb,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
     Texture *face_buffer,
     SFA *vertices,
     SU32A *indices,
     SU32A *colors);
 void draw_triangle_scanline_constant_z_with_face_buffer(
     Texture *pb,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
     Triangle t,
     uint32_t color,
     float z,
@@ -49,21 +52,31 @@ void draw_triangle_scanline_constant_z_with_face_buffer(
 void draw_triangle_scanline_with_texture(
     Texture *pb,
     Texture *texture,
-    FTexture *z_buffer,
+    DepthBuffer *z_buffer,
     Triangle t,
     Triangle t_uv,
-    float z);
+    float z,
+    AlphaMode alpha_mode,
+    DepthMode depth_mode);
+void draw_triangle_scanline_with_texture_clipped(
+    Texture *pb,
+    Texture *texture,
+    DepthBuffer *z_buffer,
+    Triangle t,
+    Triangle t_uv,
+    float z,
+    AlphaMode alpha_mode,
+    DepthMode depth_mode,
+    IRect clip);
 
 void draw_tris_textured(
     Texture *pb,
     Texture *texture,
-    FTexture *z_buffer,
-    SFA *vertices, // x,y,w,x,y,w,x,y,w
-    SU32A *indices,
-    SFA *texcoords,
-    SU32A *texcoord_indices,
-    SFA *normals, // one per face: x,y,z...
-    Vec3 cam_dir);
+    DepthBuffer *z_buffer,
+    TileRaster *tile_raster, // if not NULL the triangles are binned and drawn on tile_raster_flush
+    const SetupList *triangles,
+    AlphaMode alpha_mode, // ALPHA_AUTO goes by the texture, see span_resolve_alpha
+    DepthMode depth_mode);
 
 //////////////////////// ORTHOGRAPHIC PROJECTION ////////////////////////
 void draw_ortho_quad_lines(Texture *pb, Quad *quad, uint32_t color);
@@ -0,0 +1,113 @@
+#include "frustum.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+// row r of the matrix times sign, added to the w row
+static Vec4 plane_from_rows(const Mat4 *m, int r, float sign)
+{
+    Vec4 plane = {
+        m->m[3][0] + sign * m->m[r][0],
+        m->m[3][1] + sign * m->m[r][1],
+        m->m[3][2] + sign * m->m[r][2],
+        m->m[3][3] + sign * m->m[r][3]};
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0.0f)
+    {
+        plane.x /= length;
+        plane.y /= length;
+        plane.z /= length;
+        plane.w /= length;
+    }
+    return plane;
+}
+
+Frustum frustum_from_matrix(const Mat4 *mvp)
+{
+    Frustum frustum;
+    frustum.planes[0] = plane_from_rows(mvp, 0, 1.0f);  // left, x >= -w
+    frustum.planes[1] = plane_from_rows(mvp, 0, -1.0f); // right, x <= w
+    frustum.planes[2] = plane_from_rows(mvp, 1, 1.0f);  // bottom, y >= -w
+    frustum.planes[3] = plane_from_rows(mvp, 1, -1.0f); // top, y <= w
+    frustum.planes[4] = plane_from_rows(mvp, 2, 1.0f);  // near, z >= -w
+    return frustum;
+}
+
+bool frustum_cull_bounds(const Frustum *frustum, const Bounds *bounds)
+{
+    if (!bounds_valid(bounds))
+        return true;
+
+    for (int i = 0; i < FRUSTUM_PLANES; i++)
+    {
+        const Vec4 *p = &frustum->planes[i];
+        // the sphere settles most shapes, the box is tighter for long thin ones
+        float center = p->x * bounds->center.x + p->y * bounds->center.y + p->z * bounds->center.z + p->w;
+        if (center < -bounds->radius)
+            return true;
+
+        // the box corner furthest along the plane normal
+        float x = p->x >= 0.0f ? bounds->max.x : bounds->min.x;
+        float y = p->y >= 0.0f ? bounds->max.y : bounds->min.y;
+        float z = p->z >= 0.0f ? bounds->max.z : bounds->min.z;
+        if (p->x * x + p->y * y + p->z * z + p->w < 0.0f)
+            return true;
+    }
+    return false;
+}
+
+FrustumTest frustum_test_box(const Frustum *frustum, Vec3 min, Vec3 max)
+{
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (int i = 0; i < FRUSTUM_PLANES; i++)
+    {
+        const Vec4 *p = &frustum->planes[i];
+        // furthest corner along the normal outside means all of it is, the nearest one inside means all of it is
+        float furthest = p->x * (p->x >= 0.0f ? max.x : min.x) + p->y * (p->y >= 0.0f ? max.y : min.y) + p->z * (p->z >= 0.0f ? max.z : min.z) + p->w;
+        if (furthest < 0.0f)
+            return FRUSTUM_OUTSIDE;
+        float nearest = p->x * (p->x >= 0.0f ? min.x : max.x) + p->y * (p->y >= 0.0f ? min.y : max.y) + p->z * (p->z >= 0.0f ? min.z : max.z) + p->w;
+        if (nearest < 0.0f)
+            result = FRUSTUM_INTERSECTS;
+    }
+    return result;
+}
+
+float frustum_projected_radius(const Mat4 *mvp, const Bounds *bounds, int screen_height)
+{
+    const float (*m)[4] = mvp->m;
+    Vec3 c = bounds->center;
+    // clip w is the view depth, its row's length is how fast it grows per object space unit
+    float w = m[3][0] * c.x + m[3][1] * c.y + m[3][2] * c.z + m[3][3];
+    float w_scale = sqrtf(m[3][0] * m[3][0] + m[3][1] * m[3][1] + m[3][2] * m[3][2]);
+    float nearest = w - bounds->radius * w_scale;
+    if (nearest <= 0.0f)
+        return FLT_MAX;
+    // the y row holds the projection's focal length times the model's scale
+    float y_scale = sqrtf(m[1][0] * m[1][0] + m[1][1] * m[1][1] + m[1][2] * m[1][2]);
+    return bounds->radius * y_scale / nearest * (float)screen_height * 0.5f;
+}
+
+void frustum_print_stats(const CullStats *stats)
+{
+    printf("cull: %d / %d shapes culled, %d / %d meshlets culled + %d backfacing, %d bvh nodes tested, %d shapes at a lod, %d vertices projected\n"
+           "occlusion: %d occluders (%d triangles), %d shapes + %d meshlets occluded\n",
+           stats->shapes_culled,
+           stats->shapes_tested,
+           stats->meshlets_culled,
+           stats->meshlets_tested,
+           stats->meshlets_backfacing,
+           stats->nodes_tested,
+           stats->shapes_simplified,
+           stats->vertices_projected,
+           stats->occluders,
+           stats->occluder_triangles,
+           stats->shapes_occluded,
+           stats->meshlets_occluded);
+}
+
+void frustum_reset_stats(CullStats *stats)
+{
+    *stats = (CullStats){0};
+}
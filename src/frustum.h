@@ -0,0 +1,61 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <stdbool.h>
+
+#include "vec4.h"
+#include "mat4.h"
+#include "bounds.h"
+
+/*
+    View frustum planes pulled straight out of a model view projection matrix
+    (Gribb/Hartmann), so they live in the model's object space and the bounds
+    can be tested as they were loaded. Same planes as the vertex outcodes:
+    left, right, bottom, top and near, no far plane.
+*/
+
+#define FRUSTUM_PLANES 5
+
+typedef struct
+{
+    Vec4 planes[FRUSTUM_PLANES]; // xyz normal pointing in, w distance. normalized
+} Frustum;
+
+typedef enum
+{
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE,
+} FrustumTest;
+
+// whole shape and meshlet counts for the current frame
+typedef struct
+{
+    int shapes_tested;
+    int shapes_culled; // none of its meshlets survived
+    int nodes_tested;  // bvh nodes that went through a plane test
+    int meshlets_tested;
+    int meshlets_culled;     // outside the frustum
+    int meshlets_backfacing; // inside, but the normal cone says every face is turned away
+    int shapes_simplified; // drawn with one of their lods
+    int occluders;          // shapes drawn into the occlusion buffer
+    int occluder_triangles; // of theirs that covered a cell
+    int shapes_occluded;    // whole shape hidden behind the occluders
+    int meshlets_occluded;
+    int vertices_projected; // vertices that went through the transform, padding included
+} CullStats;
+
+Frustum frustum_from_matrix(const Mat4 *mvp);
+// true when the bounds are completely outside one of the planes. empty bounds are always outside
+bool frustum_cull_bounds(const Frustum *frustum, const Bounds *bounds);
+// box only, and tells apart boxes that are completely inside
+FrustumTest frustum_test_box(const Frustum *frustum, Vec3 min, Vec3 max);
+
+// radius in pixels of the bounding sphere on a screen screen_height tall, at its nearest point to the camera.
+// FLT_MAX when the sphere reaches the camera plane
+float frustum_projected_radius(const Mat4 *mvp, const Bounds *bounds, int screen_height);
+
+void frustum_print_stats(const CullStats *stats);
+void frustum_reset_stats(CullStats *stats);
+
+#endif // FRUSTUM_H
@@ -20,6 +20,68 @@
 
 #define AMBIENT_LIGHT 0.4f
 
+// framebuffer + z buffer pairs, up to 3. with more than one, frames get drawn on a render thread while
+// the main thread presents the last finished one
+#define RENDER_FRAMES 2
+// how many frames the render thread may get ahead of the one being presented. 1 caps the added latency at one frame,
+// RENDER_FRAMES - 1 keeps every pair busy, 0 draws and presents one after the other
+#define RENDER_MAX_FRAMES_AHEAD 1
+
+// tile binned rasterizer, 0 threads means one per cpu core. tiles have to be a multiple of HI_Z_COARSE_SIZE (64)
+// so every hi-z block belongs to one tile, render_context.c checks it
+#define RASTER_THREADS 0
+#define RASTER_TILE_SIZE 64
+
+// widest simd kernels to use: 0 scalar, 1 SSE2, 2 AVX2, 3 AVX-512
+#define SIMD_MAX_LEVEL 3
+// draw textured triangles with the half-space edge function rasterizer, false falls back to the old scanline one
+#define RASTER_HALFSPACE_TEXTURED true
+// two phase textured rendering: depth + (shape, face) ids first, then texture every pixel once.
+// see through texels hide what's behind them in this mode
+#define RASTER_VISIBILITY_BUFFER false
+// box filtered mip chains for every loaded texture, textured triangles pick a level from their uv derivatives
+#define USE_MIPMAPS true
+// loaded textures (and their mips) get stored in 4x4 texel tiles instead of rows, see TextureLayout.
+// pays off when big textures get walked across their rows, the castle's are 128x128 or smaller and sit in l1 either way
+#define USE_TILED_TEXTURES false
+// weld duplicate vertices and reorder triangles for vertex reuse when models load, prints the acmr before/after reordering
+#define OPTIMIZE_MODELS true
+// simplified versions of every shape built at load (needs OPTIMIZE_MODELS), far away shapes draw a simpler one
+#define USE_MESH_LODS true
+// how far off, in pixels, a simpler level may put the surface before the full shape gets drawn instead
+#define LOD_ERROR_PIXELS 1.0f
+// every tile draws into a block holding its own color and depth, copied out to the linear framebuffer at the end
+// of the frame (see tile_raster.h). at 720x480 the linear buffers mostly stay in cache anyway, it pays off at
+// bigger render sizes
+#define RASTER_TILED_FRAMEBUFFER false
+// tiles nothing gets drawn on are cleared (and with RASTER_TILED_FRAMEBUFFER the drawn ones copied out) with
+// non-temporal stores that go around the cache.
+// pays off once the color and z buffers outgrow the last level cache, at 720x480 (2.7 MB) they fit
+// and cached stores come out about twice as fast
+#define CLEAR_STREAMING_STORES false
+// z buffer storage, DEPTH_FORMAT_F32, _U16 or _U24 (see depth_buffer.h). --depth=f32|u16|u24 overrides it at startup.
+// u16 halves the z traffic, which matters most with lots of raster threads or big render sizes
+#define DEPTH_BUFFER_FORMAT DEPTH_FORMAT_F32
+// starting size of the per frame scratch arena, it grows by itself if a frame needs more
+#define FRAME_ARENA_SIZE (1024 * 1024)
+// hierarchical z for skipping hidden triangles/tiles/pixels, the stats get printed once a second
+#define USE_HI_Z true
+#define SHOW_HI_Z_STATS false
+// submitted / culled / rasterized triangle counts of one frame, printed once a second
+#define SHOW_SETUP_STATS false
+// skip whole shapes whose bounds are outside the view frustum, before any of their vertices get transformed
+#define USE_FRUSTUM_CULLING true
+// drop meshlets whose faces all point away from the camera before their vertices get transformed
+#define USE_MESHLET_CONE_CULLING true
+// draw the big shapes into a small depth buffer first (see occlusion.h) and skip shapes and meshlets hidden behind them
+#define USE_OCCLUSION_CULLING true
+// how big on screen (bounding sphere radius in pixels) a shape has to be to go into the occlusion buffer
+#define OCCLUDER_MIN_RADIUS_PX 64.0f
+// the occlusion buffer in the top left corner, same grays as debug_draw_z_buffer and dark red where it is empty
+#define SHOW_OCCLUSION_BUFFER false
+// shapes tested / culled and vertices projected in one frame, printed once a second
+#define SHOW_CULL_STATS false
+
 extern int WIDTH;
 extern int HEIGHT;
 
@@ -0,0 +1,186 @@
+#include "hi_z.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+#include "utils.h"
+
+HiZ *hi_z_new(int width, int height)
+{
+    HiZ *hz = (HiZ *)calloc(1, sizeof(HiZ));
+    if (!hz)
+    {
+        fprintf(stderr, "Failed to allocate memory for HiZ.\n");
+        return NULL;
+    }
+
+    hz->width = width;
+    hz->height = height;
+    hz->fine_w = (width + HI_Z_FINE_SIZE - 1) >> HI_Z_FINE_SHIFT;
+    hz->fine_h = (height + HI_Z_FINE_SIZE - 1) >> HI_Z_FINE_SHIFT;
+    hz->coarse_w = (width + HI_Z_COARSE_SIZE - 1) >> HI_Z_COARSE_SHIFT;
+    hz->coarse_h = (height + HI_Z_COARSE_SIZE - 1) >> HI_Z_COARSE_SHIFT;
+    hz->fine = (float *)malloc(sizeof(float) * hz->fine_w * hz->fine_h);
+    hz->coarse = (float *)malloc(sizeof(float) * hz->coarse_w * hz->coarse_h);
+    if (!hz->fine || !hz->coarse)
+    {
+        fprintf(stderr, "Failed to allocate hi-z levels.\n");
+        hi_z_free(hz);
+        return NULL;
+    }
+
+    hi_z_clear(hz);
+    hi_z_reset_stats(hz);
+    return hz;
+}
+
+void hi_z_free(HiZ *hz)
+{
+    if (!hz)
+    {
+        return;
+    }
+    free(hz->fine);
+    free(hz->coarse);
+    free(hz);
+}
+
+void hi_z_clear(HiZ *hz)
+{
+    for (int i = 0; i < hz->fine_w * hz->fine_h; i++)
+    {
+        hz->fine[i] = FLT_MAX;
+    }
+    for (int i = 0; i < hz->coarse_w * hz->coarse_h; i++)
+    {
+        hz->coarse[i] = FLT_MAX;
+    }
+}
+
+void hi_z_clear_rect(HiZ *hz, int x0, int y0, int x1, int y1)
+{
+    for (int fy = y0 >> HI_Z_FINE_SHIFT; fy <= y1 >> HI_Z_FINE_SHIFT; fy++)
+    {
+        for (int fx = x0 >> HI_Z_FINE_SHIFT; fx <= x1 >> HI_Z_FINE_SHIFT; fx++)
+        {
+            hz->fine[fy * hz->fine_w + fx] = FLT_MAX;
+        }
+    }
+    for (int cy = y0 >> HI_Z_COARSE_SHIFT; cy <= y1 >> HI_Z_COARSE_SHIFT; cy++)
+    {
+        for (int cx = x0 >> HI_Z_COARSE_SHIFT; cx <= x1 >> HI_Z_COARSE_SHIFT; cx++)
+        {
+            hz->coarse[cy * hz->coarse_w + cx] = FLT_MAX;
+        }
+    }
+}
+
+bool hi_z_coarse_occluded(const HiZ *hz, int x0, int y0, int x1, int y1, float z)
+{
+    int cx0 = x0 >> HI_Z_COARSE_SHIFT;
+    int cy0 = y0 >> HI_Z_COARSE_SHIFT;
+    int cx1 = x1 >> HI_Z_COARSE_SHIFT;
+    int cy1 = y1 >> HI_Z_COARSE_SHIFT;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            if (z < hz->coarse[cy * hz->coarse_w + cx])
+                return false;
+        }
+    }
+    return true;
+}
+
+bool hi_z_rect_occluded(const HiZ *hz, int x0, int y0, int x1, int y1, float z)
+{
+    // walk the coarse blocks, only look at fine blocks under the ones that don't pass outright
+    int cx0 = x0 >> HI_Z_COARSE_SHIFT;
+    int cy0 = y0 >> HI_Z_COARSE_SHIFT;
+    int cx1 = x1 >> HI_Z_COARSE_SHIFT;
+    int cy1 = y1 >> HI_Z_COARSE_SHIFT;
+    const int ratio_shift = HI_Z_COARSE_SHIFT - HI_Z_FINE_SHIFT;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            if (!(z < hz->coarse[cy * hz->coarse_w + cx]))
+                continue;
+
+            int fx0 = imax(cx << ratio_shift, x0 >> HI_Z_FINE_SHIFT);
+            int fy0 = imax(cy << ratio_shift, y0 >> HI_Z_FINE_SHIFT);
+            int fx1 = imin(((cx + 1) << ratio_shift) - 1, x1 >> HI_Z_FINE_SHIFT);
+            int fy1 = imin(((cy + 1) << ratio_shift) - 1, y1 >> HI_Z_FINE_SHIFT);
+            for (int fy = fy0; fy <= fy1; fy++)
+            {
+                const float *row = hz->fine + fy * hz->fine_w;
+                for (int fx = fx0; fx <= fx1; fx++)
+                {
+                    if (z < row[fx])
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void hi_z_update_coarse(HiZ *hz, int x0, int y0, int x1, int y1)
+{
+    int cx0 = x0 >> HI_Z_COARSE_SHIFT;
+    int cy0 = y0 >> HI_Z_COARSE_SHIFT;
+    int cx1 = x1 >> HI_Z_COARSE_SHIFT;
+    int cy1 = y1 >> HI_Z_COARSE_SHIFT;
+    const int ratio_shift = HI_Z_COARSE_SHIFT - HI_Z_FINE_SHIFT;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            int fx0 = cx << ratio_shift;
+            int fy0 = cy << ratio_shift;
+            int fx1 = imin(((cx + 1) << ratio_shift) - 1, hz->fine_w - 1);
+            int fy1 = imin(((cy + 1) << ratio_shift) - 1, hz->fine_h - 1);
+            float max_z = 0.0f;
+            for (int fy = fy0; fy <= fy1; fy++)
+            {
+                const float *row = hz->fine + fy * hz->fine_w;
+                for (int fx = fx0; fx <= fx1; fx++)
+                {
+                    max_z = fmaxf(max_z, row[fx]);
+                }
+            }
+            hz->coarse[cy * hz->coarse_w + cx] = max_z;
+        }
+    }
+}
+
+void hi_z_add_stats(HiZ *hz, const HiZCounts *counts)
+{
+    if (counts->triangles_tested)
+        SDL_AtomicAdd(&hz->stats.triangles_tested, counts->triangles_tested);
+    if (counts->triangles_rejected)
+        SDL_AtomicAdd(&hz->stats.triangles_rejected, counts->triangles_rejected);
+    if (counts->tiles_rejected)
+        SDL_AtomicAdd(&hz->stats.tiles_rejected, counts->tiles_rejected);
+    if (counts->pixels_rejected)
+        SDL_AtomicAdd(&hz->stats.pixels_rejected, counts->pixels_rejected);
+}
+
+void hi_z_print_stats(HiZ *hz)
+{
+    printf("hi-z: %d / %d triangles rejected, %d tiles rejected, %d pixels rejected\n",
+           SDL_AtomicGet(&hz->stats.triangles_rejected),
+           SDL_AtomicGet(&hz->stats.triangles_tested),
+           SDL_AtomicGet(&hz->stats.tiles_rejected),
+           SDL_AtomicGet(&hz->stats.pixels_rejected));
+}
+
+void hi_z_reset_stats(HiZ *hz)
+{
+    SDL_AtomicSet(&hz->stats.triangles_tested, 0);
+    SDL_AtomicSet(&hz->stats.triangles_rejected, 0);
+    SDL_AtomicSet(&hz->stats.tiles_rejected, 0);
+    SDL_AtomicSet(&hz->stats.pixels_rejected, 0);
+}
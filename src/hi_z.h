@@ -0,0 +1,76 @@
+#ifndef HI_Z_H
+#define HI_Z_H
+
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+
+/*
+    Hierarchical z, kept next to the full res z buffer and in the same units (see depth_buffer.h).
+    Stores the max depth of every 8x8 (fine) and 64x64 (coarse) block of pixels.
+    The z test is z < z_buffer, so anything at or behind a block's max depth can't
+    land a single pixel in that block and gets skipped without touching the z buffer.
+    Values are conservative: they only ever go down when a block is fully covered,
+    so a block that was partly drawn over just keeps its older (bigger) max.
+*/
+
+#define HI_Z_FINE_SHIFT 3
+#define HI_Z_FINE_SIZE (1 << HI_Z_FINE_SHIFT)
+#define HI_Z_COARSE_SHIFT 6
+#define HI_Z_COARSE_SIZE (1 << HI_Z_COARSE_SHIFT)
+
+// rejection counters, the raster threads add their tile's counts once the tile is done
+typedef struct
+{
+    SDL_atomic_t triangles_tested;
+    SDL_atomic_t triangles_rejected;
+    SDL_atomic_t tiles_rejected;
+    SDL_atomic_t pixels_rejected;
+} HiZStats;
+
+// one thread's counts while it draws a tile, plain ints since nothing else touches them
+typedef struct
+{
+    int triangles_tested;
+    int triangles_rejected;
+    int tiles_rejected;
+    int pixels_rejected;
+} HiZCounts;
+
+typedef struct
+{
+    int width;
+    int height;
+
+    int fine_w;
+    int fine_h;
+    float *fine; // fine_w * fine_h
+
+    int coarse_w;
+    int coarse_h;
+    float *coarse; // coarse_w * coarse_h
+
+    HiZStats stats;
+} HiZ;
+
+HiZ *hi_z_new(int width, int height);
+void hi_z_free(HiZ *hz);
+// call together with depth_buffer_clear on the z buffer
+void hi_z_clear(HiZ *hz);
+// clears the fine and coarse blocks overlapping the pixel rect (inclusive), for clearing one raster tile at a time
+void hi_z_clear_rect(HiZ *hz, int x0, int y0, int x1, int y1);
+
+// true if nothing at depth z can pass the z test anywhere in the pixel rect (inclusive)
+bool hi_z_rect_occluded(const HiZ *hz, int x0, int y0, int x1, int y1, float z);
+// same but only looks at the coarse level
+bool hi_z_coarse_occluded(const HiZ *hz, int x0, int y0, int x1, int y1, float z);
+
+// recomputes the coarse blocks overlapping the pixel rect from their fine blocks
+void hi_z_update_coarse(HiZ *hz, int x0, int y0, int x1, int y1);
+
+// adds a tile's counts to the shared stats, safe to call from any thread
+void hi_z_add_stats(HiZ *hz, const HiZCounts *counts);
+void hi_z_print_stats(HiZ *hz);
+void hi_z_reset_stats(HiZ *hz);
+
+#endif // HI_Z_H
@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -13,27 +14,14 @@
 #include "draw.h"
 #include "assets.h"
 #include "texture.h"
-#include "f_texture.h"
+#include "depth_buffer.h"
+#include "render_context.h"
+#include "render_thread.h"
+#include "present.h"
 
 int WIDTH;
 int HEIGHT;
 
-// draw fps
-void draw_fps(SDL_Renderer *renderer, TTF_Font *font, int fps)
-{
-    char fpsText[16];
-    snprintf(fpsText, sizeof(fpsText), "FPS: %d", fps);
-    SDL_Color textColor = {255, 255, 255, 255}; // White color
-    SDL_Surface *textSurface = TTF_RenderText_Solid(font, fpsText, textColor);
-    SDL_Texture *textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    int textWidth = textSurface->w;
-    int textHeight = textSurface->h;
-    SDL_Rect textRect = {10, 10, textWidth, textHeight}; // Position in top-left corner
-    SDL_RenderCopy(renderer, textTexture, NULL, &textRect);
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
-}
-
 int main(int argc, char *argv[])
 {
     // Initialize SDL
@@ -66,15 +54,32 @@ int main(int argc, char *argv[])
     SDL_SetWindowBordered(window, SDL_FALSE); // hide window borrder
 
     // Setup buffers
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    //// The SDL render texturer is just for the last step during draw.
-    SDL_Texture *renderTexture = SDL_CreateTexture(
-        renderer,
-        SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
-        RENDER_WIDTH, RENDER_HEIGHT);
+    //// The frames get drawn straight into streaming textures, see present.h
+    Presenter *presenter = presenter_new(window, RENDER_WIDTH, RENDER_HEIGHT, RENDER_FRAMES);
+    if (!presenter)
+    {
+        printf("Failed to set up presenting\n");
+        return 1;
+    }
     //// All the real rendering is happening on the pixel buffer via cpu.
-    Texture *texture = texture_new(RENDER_WIDTH, RENDER_HEIGHT);
-    FTexture *z_buffer = f_texture_new(RENDER_WIDTH, RENDER_HEIGHT);
+    Texture *background = texture_new(RENDER_WIDTH, RENDER_HEIGHT);
+    draw_background(background);
+    DepthFormat depth_format = DEPTH_BUFFER_FORMAT;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--depth=", 8) == 0 && !depth_format_from_name(argv[i] + 8, &depth_format))
+        {
+            printf("Unknown depth format %s, use f32, u16 or u24\n", argv[i] + 8);
+            return 1;
+        }
+    }
+    printf("Depth buffer: %s\n", depth_format_name(depth_format));
+    RenderContext *render_context = render_context_new(RENDER_WIDTH, RENDER_HEIGHT);
+    if (!render_context)
+    {
+        printf("Failed to create render context\n");
+        return 1;
+    }
 
     // Load assets
     Assets *assets = assets_load();
@@ -84,11 +89,22 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // the framebuffers live in the render thread, it owns assets and render_context from here on
+    RenderThread *render_thread = render_thread_new(
+        RENDER_WIDTH, RENDER_HEIGHT, depth_format, RENDER_FRAMES, RENDER_MAX_FRAMES_AHEAD,
+        assets, render_context, background);
+    if (!render_thread)
+    {
+        printf("Failed to create render thread\n");
+        return 1;
+    }
+
     // Main loop
     State *state = new_state();
     int fps = 0;
     int frameCount = 0;
     Uint32 fpsLastTime = SDL_GetTicks();
+    Uint32 statsLastTime = fpsLastTime;
     Uint32 frameStart;
     float frameTime;
     while (!state->quit)
@@ -97,28 +113,24 @@ int main(int argc, char *argv[])
 
         process_input(state);
         step(state);
-        texture_clear(texture);
-        f_texture_fill_float_max(z_buffer);
-        // fade_texture(texture, 2);
-        // color_rotate(texture, 10.0);
-        draw(texture, z_buffer, state, assets);
-
-        // clear the render texture
-        SDL_SetRenderTarget(renderer, renderTexture);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        // clear window
-        SDL_SetRenderTarget(renderer, NULL);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        // copy pixel buffer to render texture
-        copy_to_texture(texture, renderTexture);
-
-        // Draw the render texture to the window
-        SDL_Rect destRect = {0, 0, WIDTH, HEIGHT};
-        SDL_RenderCopy(renderer, renderTexture, NULL, &destRect);
+        // the stats get printed by whoever draws, once a second like the fps
+        bool print_stats = SDL_GetTicks() - statsLastTime >= 1000;
+        if (print_stats)
+        {
+            statsLastTime = SDL_GetTicks();
+        }
+        RenderFrame *next = render_thread_acquire(render_thread);
+        if (next)
+        {
+            presenter_prepare(presenter, next);
+            render_thread_submit(render_thread, next, state, print_stats);
+        }
+        // while this frame is being drawn, show the last finished one
+        RenderFrame *frame = render_thread_next(render_thread);
+        if (!frame)
+        {
+            continue;
+        }
 
         // FPS meter
         frameCount++;
@@ -128,12 +140,8 @@ int main(int argc, char *argv[])
             frameCount = 0;
             fpsLastTime = SDL_GetTicks();
         }
-        if (SHOW_FPS)
-        {
-            draw_fps(renderer, font, fps);
-        }
-
-        SDL_RenderPresent(renderer);
+        presenter_show(presenter, frame, SHOW_FPS ? font : NULL, fps);
+        render_thread_release(render_thread, frame);
 
         // Frame rate limiting
         if (FRAME_LIMITING)
@@ -148,12 +156,14 @@ int main(int argc, char *argv[])
     }
 
     // Clean up
-    texture_free(texture);
+    // the render thread finishes first, it may still be drawing into a locked texture
+    render_thread_free(render_thread);
+    presenter_free(presenter);
+    render_context_free(render_context);
+    texture_free(background);
     free_state(state);
 
     TTF_CloseFont(font);
-    SDL_DestroyTexture(renderTexture);
-    SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     TTF_Quit();
     SDL_Quit();
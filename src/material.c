@@ -24,5 +24,8 @@ void material_print(const Material *mat)
        printf("    Transparency (d): %.2f\n", mat->transparency);
        printf("    Illumination Model (illum): %d\n", mat->illumination_model);
        printf("    Diffuse Map (map_Kd): %s\n", mat->diffuse_map ? mat->diffuse_map : "None");
+       printf("    Cull Mode (cull): %s\n", mat->cull_mode == CULL_NONE ? "none" : mat->cull_mode == CULL_FRONT ? "front" : "back");
+       printf("    Alpha Mode (alpha): %s\n", mat->alpha_mode == ALPHA_OPAQUE ? "opaque" : mat->alpha_mode == ALPHA_TEST ? "test" : mat->alpha_mode == ALPHA_BLEND ? "blend" : "auto");
+       printf("    Depth Mode (depth): %s\n", mat->depth_mode == DEPTH_TEST ? "test" : mat->depth_mode == DEPTH_OFF ? "off" : "write");
        printf("\n");
 }
\ No newline at end of file
@@ -3,6 +3,32 @@
 
 #include "vec3.h"
 
+// which winding triangle setup throws away. not part of the mtl spec, set with a "cull none|back|front" line
+typedef enum
+{
+    CULL_BACK = 0, // default for a zeroed material
+    CULL_NONE,
+    CULL_FRONT,
+} CullMode;
+
+// how texels get written, set with an "alpha opaque|test|blend" line.
+// without one it's picked from what the texture's alpha channel holds, see span_resolve_alpha
+typedef enum
+{
+    ALPHA_AUTO = 0,
+    ALPHA_OPAQUE, // alpha ignored
+    ALPHA_TEST,   // texels under ALPHA_TEST_REF are skipped, z included, the rest written as is
+    ALPHA_BLEND,  // 255 written, 0 skipped, anything between blended over the framebuffer
+} AlphaMode;
+
+// z buffer use, set with a "depth write|test|off" line. test only is for see through surfaces
+typedef enum
+{
+    DEPTH_WRITE = 0, // test and write
+    DEPTH_TEST,
+    DEPTH_OFF,
+} DepthMode;
+
 typedef struct
 {
     char *name;             // Material name
@@ -15,6 +41,9 @@ typedef struct
     float transparency;     // Transparency (d)
     int illumination_model; // Illumination model (illum)
     char *diffuse_map;      // Diffuse texture map (map_Kd)
+    CullMode cull_mode;     // Face culling (cull)
+    AlphaMode alpha_mode;   // Texel alpha handling (alpha)
+    DepthMode depth_mode;   // Z buffer use (depth)
 } Material;
 
 void material_print(const Material *mat);
@@ -150,6 +150,47 @@ MaterialLibrary material_library_load(const char *path)
             {
                 sscanf(trimmed, "illum %d", &current_material.illumination_model);
             }
+            else if (strncmp(trimmed, "cull", 4) == 0)
+            {
+                char mode[16];
+                if (sscanf(trimmed, "cull %15s", mode) == 1)
+                {
+                    if (strcmp(mode, "none") == 0)
+                        current_material.cull_mode = CULL_NONE;
+                    else if (strcmp(mode, "front") == 0)
+                        current_material.cull_mode = CULL_FRONT;
+                    else
+                        current_material.cull_mode = CULL_BACK;
+                }
+            }
+            else if (strncmp(trimmed, "alpha", 5) == 0)
+            {
+                char mode[16];
+                if (sscanf(trimmed, "alpha %15s", mode) == 1)
+                {
+                    if (strcmp(mode, "opaque") == 0)
+                        current_material.alpha_mode = ALPHA_OPAQUE;
+                    else if (strcmp(mode, "test") == 0)
+                        current_material.alpha_mode = ALPHA_TEST;
+                    else if (strcmp(mode, "blend") == 0)
+                        current_material.alpha_mode = ALPHA_BLEND;
+                    else
+                        current_material.alpha_mode = ALPHA_AUTO;
+                }
+            }
+            else if (strncmp(trimmed, "depth", 5) == 0)
+            {
+                char mode[16];
+                if (sscanf(trimmed, "depth %15s", mode) == 1)
+                {
+                    if (strcmp(mode, "test") == 0)
+                        current_material.depth_mode = DEPTH_TEST;
+                    else if (strcmp(mode, "off") == 0)
+                        current_material.depth_mode = DEPTH_OFF;
+                    else
+                        current_material.depth_mode = DEPTH_WRITE;
+                }
+            }
             else if (strncmp(trimmed, "map_Kd", 6) == 0)
             {
                 char map_path[MAX_LINE_LENGTH];
@@ -14,6 +14,7 @@ Mesh *mesh_new(void)
     mesh->vertices = NULL;
     mesh->normals = NULL;
     mesh->texcoords = NULL;
+    mesh->positions = NULL;
 
     return mesh;
 }
@@ -29,6 +30,7 @@ void mesh_free(Mesh *mesh)
         sfa_free(mesh->normals);
     if (mesh->texcoords)
         sfa_free(mesh->texcoords);
+    vertex_stream_free(mesh->positions);
 
     free(mesh);
 }
@@ -84,9 +86,22 @@ Mesh *mesh_copy(const Mesh *mesh)
         memcpy(copy->texcoords->data, mesh->texcoords->data, sizeof(float) * mesh->texcoords->length);
     }
 
+    if (mesh->positions && !mesh_update_positions(copy))
+    {
+        mesh_free(copy);
+        return NULL;
+    }
+
     return copy;
 }
 
+bool mesh_update_positions(Mesh *mesh)
+{
+    vertex_stream_free(mesh->positions);
+    mesh->positions = vertex_stream_from_sfa_in(NULL, mesh->vertices);
+    return mesh->positions != NULL;
+}
+
 // mesh_transform, takes in a mesh and a transformation mat4 and applies it
 void mesh_transform(Mesh *mesh, Mat4 transform)
 {
@@ -105,4 +120,6 @@ void mesh_transform(Mesh *mesh, Mat4 transform)
         mesh->vertices->data[i + 1] = transformed.y;
         mesh->vertices->data[i + 2] = transformed.z;
     }
+    if (mesh->positions)
+        mesh_update_positions(mesh);
 }
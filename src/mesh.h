@@ -1,9 +1,12 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <stdbool.h>
+
 #include "sfa.h"
 #include "mat4.h"
 #include "su32a.h"
+#include "vertex_stream.h"
 
 //////////////////////// PRIMITIVES ////////////////////////
 // MESH: Combined Vertex and Index Data
@@ -13,6 +16,9 @@ typedef struct
     SFA *normals;   // Normal data
     SFA *texcoords; // Texture coordinate data
 
+    // vertices again as x y z w arrays for the simd transform, rebuild with mesh_update_positions
+    VertexStream *positions;
+
     // SU32A *vertex_indices;   // Index data
     // SU32A *normal_indices;   // Normal index data
     // SU32A *texcoord_indices; // Texture coordinate index data
@@ -22,5 +28,7 @@ typedef struct
 Mesh *mesh_new(void);
 void mesh_free(Mesh *mesh);
 Mesh *mesh_copy(const Mesh *mesh);
+// call after changing vertices
+bool mesh_update_positions(Mesh *mesh);
 
 #endif
\ No newline at end of file
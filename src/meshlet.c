@@ -0,0 +1,130 @@
+#include "meshlet.h"
+
+#include <math.h>
+
+// faces of the meshlet starting at first_face, stops at the first one that doesn't fit
+static int meshlet_scan(const SU32A *indices, int first_face)
+{
+    uint32_t seen[MESHLET_MAX_VERTICES];
+    int seen_count = 0;
+    int faces = indices->length / 3;
+    int face = first_face;
+    for (; face < faces && face - first_face < MESHLET_MAX_TRIANGLES; face++)
+    {
+        const uint32_t *tri = indices->data + face * 3;
+        uint32_t fresh[3];
+        int fresh_count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            bool found = false;
+            for (int i = 0; i < seen_count && !found; i++)
+                found = seen[i] == tri[k];
+            for (int i = 0; i < fresh_count && !found; i++)
+                found = fresh[i] == tri[k];
+            if (!found)
+                fresh[fresh_count++] = tri[k];
+        }
+        if (seen_count + fresh_count > MESHLET_MAX_VERTICES)
+            break;
+        for (int i = 0; i < fresh_count; i++)
+            seen[seen_count++] = fresh[i];
+    }
+    return face - first_face;
+}
+
+int meshlet_count(const SU32A *indices)
+{
+    int count = 0;
+    int faces = indices ? indices->length / 3 : 0;
+    for (int face = 0; face < faces; face += meshlet_scan(indices, face))
+        count++;
+    return count;
+}
+
+static void meshlet_cone(Meshlet *meshlet, const SFA *vertices, const SU32A *indices)
+{
+    meshlet->cone_axis = vec3_create(0.0f, 0.0f, 0.0f);
+    meshlet->cone_cutoff = 1.0f;
+
+    Vec3 sum = vec3_create(0.0f, 0.0f, 0.0f);
+    int normals = 0;
+    for (int face = meshlet->first_face; face < meshlet->end_face; face++)
+    {
+        const uint32_t *tri = indices->data + face * 3;
+        const float *p0 = vertices->data + tri[0] * 3, *p1 = vertices->data + tri[1] * 3, *p2 = vertices->data + tri[2] * 3;
+        Vec3 n = vec3_cross(
+            vec3_create(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]),
+            vec3_create(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+        float length = vec3_length(n);
+        // zero area faces never get drawn, they don't get a say in the cone either
+        if (length <= 0.0f)
+            continue;
+        sum = vec3_add(sum, vec3_div(n, length));
+        normals++;
+    }
+    float sum_length = vec3_length(sum);
+    if (normals == 0 || sum_length <= 0.0f)
+        return;
+    // the faces triangle setup keeps have (p1 - p0) x (p2 - p0) pointing away from the camera
+    // (positive screen area with y down), so the cone points the other way to face the viewer
+    Vec3 axis = vec3_div(sum, -sum_length);
+
+    float min_dot = 1.0f;
+    for (int face = meshlet->first_face; face < meshlet->end_face; face++)
+    {
+        const uint32_t *tri = indices->data + face * 3;
+        const float *p0 = vertices->data + tri[0] * 3, *p1 = vertices->data + tri[1] * 3, *p2 = vertices->data + tri[2] * 3;
+        Vec3 n = vec3_cross(
+            vec3_create(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]),
+            vec3_create(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+        float length = vec3_length(n);
+        if (length <= 0.0f)
+            continue;
+        float d = -vec3_dot(vec3_div(n, length), axis);
+        min_dot = d < min_dot ? d : min_dot;
+    }
+    // faces spread over more than ~85 degrees from the axis, there's no view that sees only their backs worth testing
+    if (min_dot <= 0.1f)
+        return;
+    meshlet->cone_axis = axis;
+    meshlet->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+int meshlet_build(const SFA *vertices, const SU32A *indices, int shape, Meshlet *out)
+{
+    int count = 0;
+    int faces = indices ? indices->length / 3 : 0;
+    for (int face = 0; face < faces;)
+    {
+        int length = meshlet_scan(indices, face);
+        Meshlet *meshlet = &out[count++];
+        meshlet->shape = shape;
+        meshlet->first_face = face;
+        meshlet->end_face = face + length;
+
+        SU32A range = {length * 3, indices->data + face * 3};
+        meshlet->bounds = bounds_from_indices(vertices, &range);
+        uint32_t lo = UINT32_MAX, hi = 0;
+        for (int i = 0; i < range.length; i++)
+        {
+            lo = range.data[i] < lo ? range.data[i] : lo;
+            hi = range.data[i] > hi ? range.data[i] : hi;
+        }
+        meshlet->vertex_first = (int)lo;
+        meshlet->vertex_end = (int)hi + 1;
+        meshlet_cone(meshlet, vertices, indices);
+        face += length;
+    }
+    return count;
+}
+
+bool meshlet_backfacing(const Meshlet *meshlet, Vec3 camera, CullMode cull_mode)
+{
+    if (cull_mode == CULL_NONE || meshlet->cone_cutoff >= 1.0f)
+        return false;
+    // culling front faces drops the meshlets the camera looks at head on instead
+    Vec3 axis = cull_mode == CULL_FRONT ? vec3_mul(meshlet->cone_axis, -1.0f) : meshlet->cone_axis;
+    // looking along the axis means looking at the backs. the sphere makes it hold from anywhere the camera could see a face from
+    Vec3 to_center = vec3_sub(meshlet->bounds.center, camera);
+    return vec3_dot(to_center, axis) >= meshlet->cone_cutoff * vec3_length(to_center) + meshlet->bounds.radius;
+}
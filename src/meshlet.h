@@ -0,0 +1,45 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <stdbool.h>
+
+#include "vec3.h"
+#include "sfa.h"
+#include "su32a.h"
+#include "bounds.h"
+#include "material.h"
+
+/*
+    Meshlets: runs of a shape's faces small enough to cull as one piece.
+    The faces are taken in index order (the vertex cache order keeps them close together)
+    and a meshlet is closed when the next face would push it past MESHLET_MAX_VERTICES
+    distinct vertices or MESHLET_MAX_TRIANGLES faces.
+    Besides its bounds every meshlet has a normal cone, the average face normal and how far
+    the faces stray from it, so a meshlet whose faces all point away from the camera can be
+    dropped before any of its vertices get transformed.
+*/
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+typedef struct
+{
+    int shape;
+    int first_face; // faces [first_face, end_face) of the shape
+    int end_face;
+    int vertex_first; // the faces only use vertices [vertex_first, vertex_end)
+    int vertex_end;
+    Bounds bounds;     // object space
+    Vec3 cone_axis;    // average front face normal, object space
+    float cone_cutoff; // sine of the angle the faces stray from the axis, 1 or more never culls
+} Meshlet;
+
+// splits the faces of indices into meshlets in order, out needs room for meshlet_count of them.
+// vertices is x y z per vertex, front faces wound the way triangle setup keeps them
+int meshlet_count(const SU32A *indices);
+int meshlet_build(const SFA *vertices, const SU32A *indices, int shape, Meshlet *out);
+
+// true when every face is turned away from camera (object space) and cull_mode would drop them all
+bool meshlet_backfacing(const Meshlet *meshlet, Vec3 camera, CullMode cull_mode);
+
+#endif // MESHLET_H
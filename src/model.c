@@ -9,6 +9,9 @@
 #include "mesh.h"
 #include "sfa.h"
 #include "su32a.h"
+#include "model_optimize.h"
+#include "model_lod.h"
+#include "globals.h"
 #include "utils.h" // Assume this contains trim_whitespace and other helper functions
 
 #define MAX_LINE_LENGTH 1024
@@ -20,6 +23,11 @@ static int initialize_shape(Shape *shape)
     shape->vertex_indices = su32a_new(0);
     shape->normal_indices = su32a_new(0);
     shape->texcoord_indices = su32a_new(0);
+    shape->bounds = bounds_empty();
+    shape->vertex_first = 0;
+    shape->vertex_end = 0;
+    memset(shape->lods, 0, sizeof(shape->lods));
+    shape->lod_count = 0;
     if (!shape->vertex_indices || !shape->normal_indices || !shape->texcoord_indices)
     {
         fprintf(stderr, "Failed to initialize Shape's indices.\n");
@@ -294,7 +302,7 @@ Model *model_load_from_file(const char *filename)
             { // %*s skips "o" or "g"
                 // Find the next shape in the shapes array
                 current_shape_index++;
-                if (current_shape_index >= model->shape_count)
+                if ((size_t)current_shape_index >= model->shape_count)
                 {
                     fprintf(stderr, "More shapes in file than allocated.\n");
                     model_free(model);
@@ -326,7 +334,7 @@ Model *model_load_from_file(const char *filename)
             char material_name[MAX_LINE_LENGTH];
             if (sscanf(trimmed, "usemtl %s", material_name) == 1)
             {
-                if (current_shape_index < 0 || current_shape_index >= model->shape_count)
+                if (current_shape_index < 0 || (size_t)current_shape_index >= model->shape_count)
                 {
                     fprintf(stderr, "usemtl encountered before any shape definition.\n");
                     model_free(model);
@@ -449,7 +457,7 @@ Model *model_load_from_file(const char *filename)
                 }
 
                 // Ensure there is a current shape
-                if (current_shape_index < 0 || current_shape_index >= model->shape_count)
+                if (current_shape_index < 0 || (size_t)current_shape_index >= model->shape_count)
                 {
                     fprintf(stderr, "Face encountered before any shape definition.\n");
                     model_free(model);
@@ -512,6 +520,29 @@ Model *model_load_from_file(const char *filename)
         return NULL;
     }
 
+    // a failed pass leaves the model as loaded, or welded but not reordered, both draw fine
+    if (OPTIMIZE_MODELS && !model_optimize(model))
+    {
+        fprintf(stderr, "Failed to optimize model: %s\n", filename);
+    }
+    if (USE_MESH_LODS && !model_build_lods(model))
+    {
+        fprintf(stderr, "Failed to build lods for model: %s\n", filename);
+    }
+
+    if (model->mesh->vertices && !mesh_update_positions(model->mesh))
+    {
+        fprintf(stderr, "Failed to build vertex positions for model: %s\n", filename);
+        model_free(model);
+        return NULL;
+    }
+    if (!model_update_bounds(model))
+    {
+        fprintf(stderr, "Failed to build bounds for model: %s\n", filename);
+        model_free(model);
+        return NULL;
+    }
+
     return model;
 }
 
@@ -527,9 +558,10 @@ void model_free(Model *model)
         {
             mesh_free(model->mesh);
         }
+        bvh_free(model->bvh);
         if (model->shapes)
         {
-            for (int i = 0; i < model->shape_count; i++)
+            for (size_t i = 0; i < model->shape_count; i++)
             {
                 shape_free(&model->shapes[i]);
             }
@@ -559,15 +591,55 @@ void model_print(const Model *model)
     }
 
     printf("Shapes:\n");
-    for (int i = 0; i < model->shape_count; i++)
+    for (size_t i = 0; i < model->shape_count; i++)
     {
-        printf("  Shape %d:\n", i + 1);
+        printf("  Shape %zu:\n", i + 1);
         printf("    Name: %s\n", model->shapes[i].name ? model->shapes[i].name : "Unknown Shape");
         printf("    Material: %s\n", model->shapes[i].material_name ? model->shapes[i].material_name : "Unknown Material");
         printf("    Num_Faces: %d\n", model->shapes[i].vertex_indices ? model->shapes[i].vertex_indices->length / 3 : 0);
     }
 }
 
+// [first, end) of the vertices indices uses, 0 0 when it's empty
+static void index_range(const SU32A *indices, int *first, int *end)
+{
+    *first = 0;
+    *end = 0;
+    if (!indices || indices->length == 0)
+        return;
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (int j = 0; j < indices->length; j++)
+    {
+        uint32_t v = indices->data[j];
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+    }
+    *first = (int)lo;
+    *end = (int)hi + 1;
+}
+
+bool model_update_bounds(Model *model)
+{
+    const SFA *vertices = model->mesh ? model->mesh->vertices : NULL;
+    model->bounds = bounds_from_vertices(vertices);
+    for (size_t i = 0; i < model->shape_count; i++)
+    {
+        Shape *shape = &model->shapes[i];
+        shape->bounds = bounds_from_indices(vertices, shape->vertex_indices);
+        index_range(shape->vertex_indices, &shape->vertex_first, &shape->vertex_end);
+        if (shape->lod_count < 1)
+            shape->lod_count = 1;
+        shape->lods[0].indices = shape->vertex_indices;
+        shape->lods[0].error = 0.0f;
+        for (int l = 0; l < shape->lod_count; l++)
+            index_range(shape->lods[l].indices, &shape->lods[l].vertex_first, &shape->lods[l].vertex_end);
+    }
+
+    bvh_free(model->bvh);
+    model->bvh = bvh_new(vertices, model->shapes, (int)model->shape_count);
+    return model->bvh != NULL;
+}
+
 Shape *model_get_shape(const Model *model, const char *name)
 {
     for (size_t i = 0; i < model->shape_count; i++)
@@ -3,8 +3,11 @@
 
 #include "mesh.h"
 #include "shape.h"
+#include "bounds.h"
+#include "bvh.h"
 
 #include <stddef.h>
+#include <stdbool.h>
 
 // Model struct holds shape shared vertex data and an array of shapes
 typedef struct
@@ -15,11 +18,16 @@ typedef struct
     Mesh *mesh;    // vertices/normals/texcoords
     Shape *shapes; // array of shapes (submeshes)
     size_t shape_count;
+
+    Bounds bounds; // every vertex, object space
+    Bvh *bvh;      // over the shapes' faces, for culling
 } Model;
 
 Model *model_load_from_file(const char *filename);
 void model_free(Model *model);
 void model_print(const Model *model);
+// bounds, vertex ranges and bvh of the model and its shapes, call after changing vertices or indices
+bool model_update_bounds(Model *model);
 
 Shape *model_get_shape(const Model *model, const char *name);
 
@@ -0,0 +1,589 @@
+#include "model_lod.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "model_optimize.h"
+
+//////////////////////// QUADRICS ////////////////////////
+
+// symmetric 4x4, the upper triangle of the plane's outer product: aa ab ac ad bb bc bd cc cd dd
+typedef struct
+{
+    double q[10];
+} Quadric;
+
+static void quadric_add_plane(Quadric *quadric, double a, double b, double c, double d, double weight)
+{
+    double *q = quadric->q;
+    q[0] += weight * a * a;
+    q[1] += weight * a * b;
+    q[2] += weight * a * c;
+    q[3] += weight * a * d;
+    q[4] += weight * b * b;
+    q[5] += weight * b * c;
+    q[6] += weight * b * d;
+    q[7] += weight * c * c;
+    q[8] += weight * c * d;
+    q[9] += weight * d * d;
+}
+
+static void quadric_add(Quadric *quadric, const Quadric *other)
+{
+    for (int i = 0; i < 10; i++)
+        quadric->q[i] += other->q[i];
+}
+
+// summed squared distance to the planes
+static double quadric_eval(const Quadric *quadric, const float *p)
+{
+    const double *q = quadric->q;
+    double x = p[0], y = p[1], z = p[2];
+    double e = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x +
+               q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+               q[7] * z * z + 2.0 * q[8] * z +
+               q[9];
+    return e > 0.0 ? e : 0.0;
+}
+
+//////////////////////// SIMPLIFIER ////////////////////////
+
+/*
+    Works on one shape at a time. The shape's vertices get local ids (global - base), and every
+    set of vertices sharing a position is one point, named by the lowest local id in it.
+    Collapses happen between points, the triangles keep their original corners and look up
+    where a corner's point went through collapse[].
+*/
+typedef struct
+{
+    const float *positions; // global x y z
+    int base;               // lowest global vertex the shape uses
+    int count;              // local ids 0..count-1
+
+    int *point;      // local vertex -> its point
+    int *collapse;   // point -> the point it collapsed onto, itself while alive
+    bool *seam;      // point has more than one texcoord
+    bool *border;    // point is on an open edge
+    bool *complex;   // point is on an edge shared by more than two triangles
+    bool *touched;   // point changed this pass
+    Quadric *quadrics; // what the collapses get ranked by, borders weighted up
+    Quadric *errors;   // the same planes all weighted 1, how far the surface really moved
+
+    int *corners; // 3 local vertices per triangle still standing
+    int triangle_count;
+
+    // scratch, rebuilt every pass
+    int *first_triangle; // point -> its run in point_triangles
+    int *point_triangles;
+    int *edges; // 2 points + triangle count per unique edge
+    int edge_count;
+    double max_error; // biggest error of a collapse so far, squared distance
+} Simplifier;
+
+typedef struct
+{
+    double cost;
+    int from;
+    int to;
+} Collapse;
+
+static void simplifier_free(Simplifier *s)
+{
+    free(s->point);
+    free(s->collapse);
+    free(s->seam);
+    free(s->border);
+    free(s->complex);
+    free(s->touched);
+    free(s->quadrics);
+    free(s->errors);
+    free(s->corners);
+    free(s->first_triangle);
+    free(s->point_triangles);
+    free(s->edges);
+}
+
+static int find_point(const Simplifier *s, int p)
+{
+    while (s->collapse[p] != p)
+        p = s->collapse[p];
+    return p;
+}
+
+static const float *point_position(const Simplifier *s, int p)
+{
+    return s->positions + (s->base + p) * 3;
+}
+
+static int corner_point(const Simplifier *s, int triangle, int k)
+{
+    return find_point(s, s->point[s->corners[triangle * 3 + k]]);
+}
+
+// sorted by position, then texcoord, so points and their texcoords come out as runs
+typedef struct
+{
+    uint32_t bits[5];
+    int vertex;
+} VertexKey;
+
+static int compare_vertex_keys(const void *a, const void *b)
+{
+    const VertexKey *ka = (const VertexKey *)a, *kb = (const VertexKey *)b;
+    int c = memcmp(ka->bits, kb->bits, sizeof(ka->bits));
+    return c ? c : ka->vertex - kb->vertex;
+}
+
+static int compare_edges(const void *a, const void *b)
+{
+    const int *ea = (const int *)a, *eb = (const int *)b;
+    return ea[0] != eb[0] ? ea[0] - eb[0] : ea[1] - eb[1];
+}
+
+static int compare_collapses(const void *a, const void *b)
+{
+    double ca = ((const Collapse *)a)->cost, cb = ((const Collapse *)b)->cost;
+    return (ca > cb) - (ca < cb);
+}
+
+// drops triangles that lost an edge, then rebuilds the point -> triangle lists and the edge list
+static bool simplifier_prepare_pass(Simplifier *s)
+{
+    int kept = 0;
+    for (int t = 0; t < s->triangle_count; t++)
+    {
+        int p0 = corner_point(s, t, 0), p1 = corner_point(s, t, 1), p2 = corner_point(s, t, 2);
+        if (p0 == p1 || p1 == p2 || p2 == p0)
+            continue;
+        memmove(s->corners + kept * 3, s->corners + t * 3, sizeof(int) * 3);
+        kept++;
+    }
+    s->triangle_count = kept;
+
+    memset(s->first_triangle, 0, sizeof(int) * (s->count + 1));
+    for (int t = 0; t < s->triangle_count; t++)
+        for (int k = 0; k < 3; k++)
+            s->first_triangle[corner_point(s, t, k) + 1]++;
+    for (int p = 0; p < s->count; p++)
+        s->first_triangle[p + 1] += s->first_triangle[p];
+    int *fill = (int *)malloc(sizeof(int) * s->count);
+    if (!fill)
+    {
+        fprintf(stderr, "Failed to allocate simplifier scratch.\n");
+        return false;
+    }
+    memcpy(fill, s->first_triangle, sizeof(int) * s->count);
+    for (int t = 0; t < s->triangle_count; t++)
+        for (int k = 0; k < 3; k++)
+            s->point_triangles[fill[corner_point(s, t, k)]++] = t;
+    free(fill);
+
+    // every triangle's 3 edges low point first, sorted, then duplicates folded into a count
+    int raw = s->triangle_count * 3;
+    for (int t = 0; t < s->triangle_count; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int a = corner_point(s, t, k), b = corner_point(s, t, (k + 1) % 3);
+            int *e = s->edges + (t * 3 + k) * 3;
+            e[0] = a < b ? a : b;
+            e[1] = a < b ? b : a;
+            e[2] = 1;
+        }
+    }
+    qsort(s->edges, raw, sizeof(int) * 3, compare_edges);
+    s->edge_count = 0;
+    for (int i = 0; i < raw; i++)
+    {
+        int *e = s->edges + i * 3;
+        if (s->edge_count > 0)
+        {
+            int *last = s->edges + (s->edge_count - 1) * 3;
+            if (last[0] == e[0] && last[1] == e[1])
+            {
+                last[2]++;
+                continue;
+            }
+        }
+        memmove(s->edges + s->edge_count * 3, e, sizeof(int) * 3);
+        s->edge_count++;
+    }
+    return true;
+}
+
+static void face_normal(const float *p0, const float *p1, const float *p2, double n[3])
+{
+    double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static bool simplifier_init(Simplifier *s, const SFA *vertices, const SFA *texcoords, const SU32A *indices)
+{
+    memset(s, 0, sizeof(*s));
+    s->positions = vertices->data;
+
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (int i = 0; i < indices->length; i++)
+    {
+        lo = indices->data[i] < lo ? indices->data[i] : lo;
+        hi = indices->data[i] > hi ? indices->data[i] : hi;
+    }
+    s->base = (int)lo;
+    s->count = (int)(hi - lo) + 1;
+    s->triangle_count = indices->length / 3;
+
+    s->point = (int *)malloc(sizeof(int) * s->count);
+    s->collapse = (int *)malloc(sizeof(int) * s->count);
+    s->seam = (bool *)calloc(s->count, sizeof(bool));
+    s->border = (bool *)calloc(s->count, sizeof(bool));
+    s->complex = (bool *)calloc(s->count, sizeof(bool));
+    s->touched = (bool *)calloc(s->count, sizeof(bool));
+    s->quadrics = (Quadric *)calloc(s->count, sizeof(Quadric));
+    s->errors = (Quadric *)calloc(s->count, sizeof(Quadric));
+    s->corners = (int *)malloc(sizeof(int) * s->triangle_count * 3);
+    s->first_triangle = (int *)malloc(sizeof(int) * (s->count + 1));
+    s->point_triangles = (int *)malloc(sizeof(int) * s->triangle_count * 3);
+    s->edges = (int *)malloc(sizeof(int) * s->triangle_count * 9);
+    VertexKey *keys = (VertexKey *)malloc(sizeof(VertexKey) * s->count);
+    if (!s->point || !s->collapse || !s->seam || !s->border || !s->complex || !s->touched || !s->quadrics || !s->errors ||
+        !s->corners || !s->first_triangle || !s->point_triangles || !s->edges || !keys)
+    {
+        fprintf(stderr, "Failed to allocate simplifier.\n");
+        free(keys);
+        return false;
+    }
+
+    for (int i = 0; i < indices->length; i++)
+        s->corners[i] = (int)indices->data[i] - s->base;
+
+    // group the shape's vertices by position, a group with more than one texcoord is a seam
+    int key_count = 0;
+    for (int v = 0; v < s->count; v++)
+    {
+        s->point[v] = v;
+        s->collapse[v] = v;
+    }
+    for (int i = 0; i < indices->length; i++)
+    {
+        // point doubles as a seen flag until the groups are known
+        int v = s->corners[i];
+        if (s->point[v] < 0)
+            continue;
+        s->point[v] = -1;
+        VertexKey *key = &keys[key_count++];
+        memset(key->bits, 0, sizeof(key->bits));
+        memcpy(key->bits, point_position(s, v), sizeof(float) * 3);
+        if (texcoords)
+            memcpy(key->bits + 3, texcoords->data + (s->base + v) * 2, sizeof(float) * 2);
+        key->vertex = v;
+    }
+    qsort(keys, key_count, sizeof(VertexKey), compare_vertex_keys);
+    for (int first = 0, end = 0; first < key_count; first = end)
+    {
+        // the lowest id of the position leads, the keys are sorted by id only within one texcoord
+        int leader = keys[first].vertex;
+        bool seam = false;
+        for (end = first + 1; end < key_count && memcmp(keys[end].bits, keys[first].bits, sizeof(float) * 3) == 0; end++)
+        {
+            leader = keys[end].vertex < leader ? keys[end].vertex : leader;
+            seam = seam || memcmp(keys[end].bits + 3, keys[first].bits + 3, sizeof(float) * 2) != 0;
+        }
+        for (int j = first; j < end; j++)
+            s->point[keys[j].vertex] = leader;
+        s->seam[leader] = seam;
+    }
+    free(keys);
+
+    if (!simplifier_prepare_pass(s))
+        return false;
+
+    // edges with one triangle are open borders, more than two is something the collapses leave alone
+    for (int i = 0; i < s->edge_count; i++)
+    {
+        const int *e = s->edges + i * 3;
+        if (e[2] == 1)
+            s->border[e[0]] = s->border[e[1]] = true;
+        else if (e[2] > 2)
+            s->complex[e[0]] = s->complex[e[1]] = true;
+    }
+
+    for (int t = 0; t < s->triangle_count; t++)
+    {
+        int p[3] = {corner_point(s, t, 0), corner_point(s, t, 1), corner_point(s, t, 2)};
+        const float *v[3] = {point_position(s, p[0]), point_position(s, p[1]), point_position(s, p[2])};
+        double n[3];
+        face_normal(v[0], v[1], v[2], n);
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0)
+            continue;
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        double d = -(n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2]);
+        for (int k = 0; k < 3; k++)
+        {
+            quadric_add_plane(&s->quadrics[p[k]], n[0], n[1], n[2], d, 1.0);
+            quadric_add_plane(&s->errors[p[k]], n[0], n[1], n[2], d, 1.0);
+        }
+
+        // open edges get a plane through them standing up off the face, so border points stay on the outline
+        for (int k = 0; k < 3; k++)
+        {
+            int a = p[k], b = p[(k + 1) % 3];
+            int key[3] = {a < b ? a : b, a < b ? b : a, 0};
+            const int *e = (const int *)bsearch(key, s->edges, s->edge_count, sizeof(int) * 3, compare_edges);
+            if (!e || e[2] != 1)
+                continue;
+            const float *pa = v[k], *pb = v[(k + 1) % 3];
+            double dir[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            double bn[3] = {
+                dir[1] * n[2] - dir[2] * n[1],
+                dir[2] * n[0] - dir[0] * n[2],
+                dir[0] * n[1] - dir[1] * n[0]};
+            double bl = sqrt(bn[0] * bn[0] + bn[1] * bn[1] + bn[2] * bn[2]);
+            if (bl <= 0.0)
+                continue;
+            bn[0] /= bl;
+            bn[1] /= bl;
+            bn[2] /= bl;
+            double bd = -(bn[0] * pa[0] + bn[1] * pa[1] + bn[2] * pa[2]);
+            quadric_add_plane(&s->quadrics[a], bn[0], bn[1], bn[2], bd, LOD_BORDER_WEIGHT);
+            quadric_add_plane(&s->quadrics[b], bn[0], bn[1], bn[2], bd, LOD_BORDER_WEIGHT);
+            quadric_add_plane(&s->errors[a], bn[0], bn[1], bn[2], bd, 1.0);
+            quadric_add_plane(&s->errors[b], bn[0], bn[1], bn[2], bd, 1.0);
+        }
+    }
+    return true;
+}
+
+// from can only move if it's a plain point, or a border point sliding along its border to another one
+static bool can_collapse(const Simplifier *s, int from, int to, int edge_triangles)
+{
+    if (s->seam[from] || s->complex[from] || s->seam[to])
+        return false;
+    if (s->border[from])
+        return edge_triangles == 1 && s->border[to];
+    return true;
+}
+
+// moving from onto to mustn't turn any of from's other triangles over
+static bool collapse_flips(const Simplifier *s, int from, int to)
+{
+    for (int i = s->first_triangle[from]; i < s->first_triangle[from + 1]; i++)
+    {
+        int t = s->point_triangles[i];
+        int p[3] = {corner_point(s, t, 0), corner_point(s, t, 1), corner_point(s, t, 2)};
+        if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+            continue;
+        if (p[0] == to || p[1] == to || p[2] == to)
+            continue;
+        const float *before[3], *after[3];
+        for (int k = 0; k < 3; k++)
+        {
+            before[k] = point_position(s, p[k]);
+            after[k] = p[k] == from ? point_position(s, to) : before[k];
+        }
+        double n0[3], n1[3];
+        face_normal(before[0], before[1], before[2], n0);
+        face_normal(after[0], after[1], after[2], n1);
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0)
+            return true;
+    }
+    return false;
+}
+
+// triangles that go away when from lands on to
+static int collapse_removes(const Simplifier *s, int from, int to)
+{
+    int removed = 0;
+    for (int i = s->first_triangle[from]; i < s->first_triangle[from + 1]; i++)
+    {
+        int t = s->point_triangles[i];
+        int p[3] = {corner_point(s, t, 0), corner_point(s, t, 1), corner_point(s, t, 2)};
+        if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+            continue;
+        if (p[0] == to || p[1] == to || p[2] == to)
+            removed++;
+    }
+    return removed;
+}
+
+// collapses the cheapest edges until at most target triangles are left, or nothing more can go
+static bool simplifier_run(Simplifier *s, int target)
+{
+    int alive = s->triangle_count;
+    while (alive > target)
+    {
+        if (!simplifier_prepare_pass(s))
+            return false;
+        alive = s->triangle_count;
+        if (alive <= target)
+            break;
+
+        Collapse *collapses = (Collapse *)malloc(sizeof(Collapse) * (s->edge_count + 1));
+        if (!collapses)
+        {
+            fprintf(stderr, "Failed to allocate simplifier collapses.\n");
+            return false;
+        }
+        int collapse_count = 0;
+        for (int i = 0; i < s->edge_count; i++)
+        {
+            const int *e = s->edges + i * 3;
+            Collapse best = {INFINITY, -1, -1};
+            for (int dir = 0; dir < 2; dir++)
+            {
+                int from = e[dir], to = e[1 - dir];
+                if (!can_collapse(s, from, to, e[2]))
+                    continue;
+                double cost = quadric_eval(&s->quadrics[from], point_position(s, to));
+                if (cost < best.cost)
+                    best = (Collapse){cost, from, to};
+            }
+            if (best.from >= 0)
+                collapses[collapse_count++] = best;
+        }
+        qsort(collapses, collapse_count, sizeof(Collapse), compare_collapses);
+
+        // one collapse per neighbourhood per pass, the lists and costs around it are stale after
+        memset(s->touched, 0, sizeof(bool) * s->count);
+        int done = 0;
+        for (int i = 0; i < collapse_count && alive > target; i++)
+        {
+            const Collapse *c = &collapses[i];
+            if (s->touched[c->from] || s->touched[c->to])
+                continue;
+            if (collapse_flips(s, c->from, c->to))
+                continue;
+
+            alive -= collapse_removes(s, c->from, c->to);
+            for (int j = s->first_triangle[c->from]; j < s->first_triangle[c->from + 1]; j++)
+                for (int k = 0; k < 3; k++)
+                    s->touched[corner_point(s, s->point_triangles[j], k)] = true;
+            double error = quadric_eval(&s->errors[c->from], point_position(s, c->to));
+            if (error > s->max_error)
+                s->max_error = error;
+            s->collapse[c->from] = c->to;
+            quadric_add(&s->quadrics[c->to], &s->quadrics[c->from]);
+            quadric_add(&s->errors[c->to], &s->errors[c->from]);
+            s->touched[c->to] = true;
+            done++;
+        }
+        free(collapses);
+        if (done == 0)
+            break;
+    }
+    return simplifier_prepare_pass(s);
+}
+
+// the triangles left, back in global vertex ids. a corner whose point moved takes the vertex
+// that leads the point it landed on, which is safe because seam points never take collapses
+static SU32A *simplifier_indices(const Simplifier *s)
+{
+    SU32A *indices = su32a_new(s->triangle_count * 3);
+    if (!indices)
+    {
+        fprintf(stderr, "Failed to allocate lod indices.\n");
+        return NULL;
+    }
+    for (int i = 0; i < s->triangle_count * 3; i++)
+    {
+        int v = s->corners[i];
+        int p = find_point(s, s->point[v]);
+        indices->data[i] = (uint32_t)(s->base + (p == s->point[v] ? v : p));
+    }
+    return indices;
+}
+
+//////////////////////// MODEL ////////////////////////
+
+bool model_build_lods(Model *model)
+{
+    Mesh *mesh = model->mesh;
+    if (!mesh || !mesh->vertices)
+        return true;
+    // the levels share one index for all the attributes, that needs the welded layout
+    for (size_t i = 0; i < model->shape_count; i++)
+    {
+        if (model->shapes[i].texcoord_indices || model->shapes[i].normal_indices)
+            return true;
+    }
+
+    int vertex_count = mesh->vertices->length / 3;
+    int triangles[SHAPE_MAX_LODS] = {0};
+    bool ok = true;
+    for (size_t i = 0; i < model->shape_count && ok; i++)
+    {
+        Shape *shape = &model->shapes[i];
+        int faces = shape->vertex_indices->length / 3;
+        shape->lods[0] = (ShapeLod){shape->vertex_indices, 0.0f, 0, 0};
+        shape->lod_count = 1;
+        triangles[0] += faces;
+        if (faces < 2)
+            continue;
+
+        Simplifier s;
+        if (!simplifier_init(&s, mesh->vertices, mesh->texcoords, shape->vertex_indices))
+        {
+            simplifier_free(&s);
+            ok = false;
+            break;
+        }
+        int previous = faces;
+        for (int level = 1; level < SHAPE_MAX_LODS; level++)
+        {
+            if (!simplifier_run(&s, (int)(previous * LOD_REDUCTION)))
+            {
+                ok = false;
+                break;
+            }
+            if (s.triangle_count == 0 || s.triangle_count > previous * LOD_MIN_REDUCTION)
+                break;
+
+            SU32A *indices = simplifier_indices(&s);
+            if (!indices || !model_optimize_triangle_order(indices, vertex_count))
+            {
+                if (indices)
+                    su32a_free(indices);
+                ok = false;
+                break;
+            }
+            shape->lods[level] = (ShapeLod){indices, (float)sqrt(s.max_error), 0, 0};
+            shape->lod_count++;
+            previous = s.triangle_count;
+        }
+        simplifier_free(&s);
+    }
+
+    for (size_t i = 0; i < model->shape_count; i++)
+    {
+        const Shape *shape = &model->shapes[i];
+        for (int level = 1; level < SHAPE_MAX_LODS; level++)
+        {
+            const ShapeLod *lod = &shape->lods[level < shape->lod_count ? level : shape->lod_count - 1];
+            triangles[level] += lod->indices->length / 3;
+        }
+    }
+    printf("%s: lod triangles %d -> %d -> %d -> %d\n",
+           model->name ? model->name : "model",
+           triangles[0], triangles[1], triangles[2], triangles[3]);
+
+    // every level's vertices at the front of its shape, so drawing a level projects only those
+    return model_reorder_vertices(model) && ok;
+}
+
+int model_lod_pick(const Shape *shape, float radius_px, float error_px)
+{
+    if (shape->bounds.radius <= 0.0f)
+        return 0;
+    float pixels_per_unit = radius_px / shape->bounds.radius;
+    int level = 0;
+    while (level + 1 < shape->lod_count && shape->lods[level + 1].error * pixels_per_unit <= error_px)
+        level++;
+    return level;
+}
@@ -0,0 +1,33 @@
+#ifndef MODEL_LOD_H
+#define MODEL_LOD_H
+
+#include <stdbool.h>
+
+#include "model.h"
+
+/*
+    Levels of detail for every shape, built at load by quadric error edge collapses
+    (Garland and Heckbert). Collapses are half edge: a vertex moves onto a neighbour,
+    so the levels index the same vertex pool as the full shape and no new vertices get made.
+    Vertices on a uv seam (one position with several texcoords) never move and nothing
+    collapses onto them, so the texture mapping along seams stays exactly as it was.
+    Open borders only slide along themselves, which keeps the outline of the separate
+    pieces the castle is made of. Needs a welded model (see model_optimize).
+*/
+
+// each level aims for this fraction of the triangles of the one before
+#define LOD_REDUCTION 0.5f
+// a level that can't get under this fraction of the one before isn't worth keeping, and ends the chain
+#define LOD_MIN_REDUCTION 0.85f
+// how much more the planes holding open borders in place count than the faces' own planes
+#define LOD_BORDER_WEIGHT 10.0f
+
+// fills shape->lods[1..] and puts every shape's coarsest level's vertices first.
+// false when something failed, the shapes keep whatever levels got built
+bool model_build_lods(Model *model);
+
+// the simplest level whose error stays under error_px pixels,
+// radius_px is how big the shape's bounding sphere is on screen
+int model_lod_pick(const Shape *shape, float radius_px, float error_px);
+
+#endif // MODEL_LOD_H
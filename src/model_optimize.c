@@ -0,0 +1,485 @@
+#include "model_optimize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+//////////////////////// WELD ////////////////////////
+
+// position, texcoord and normal of one corner, compared and hashed as raw bits
+#define WELD_FLOATS 8
+
+static void corner_key(const Mesh *mesh, const Shape *shape, int corner, float key[WELD_FLOATS])
+{
+    memset(key, 0, sizeof(float) * WELD_FLOATS);
+    uint32_t v = shape->vertex_indices->data[corner];
+    memcpy(key, mesh->vertices->data + v * 3, sizeof(float) * 3);
+    if (mesh->texcoords && shape->texcoord_indices)
+        memcpy(key + 3, mesh->texcoords->data + shape->texcoord_indices->data[corner] * 2, sizeof(float) * 2);
+    if (mesh->normals && shape->normal_indices)
+        memcpy(key + 5, mesh->normals->data + shape->normal_indices->data[corner] * 3, sizeof(float) * 3);
+}
+
+static uint32_t key_hash(const float key[WELD_FLOATS])
+{
+    uint32_t bits[WELD_FLOATS];
+    memcpy(bits, key, sizeof(bits));
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < WELD_FLOATS; i++)
+    {
+        h ^= bits[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+bool model_weld_vertices(Model *model)
+{
+    Mesh *mesh = model->mesh;
+    if (!mesh || !mesh->vertices)
+        return true;
+
+    int corner_count = 0;
+    for (size_t s = 0; s < model->shape_count; s++)
+        corner_count += model->shapes[s].vertex_indices->length;
+    if (corner_count == 0)
+        return true;
+
+    int table_size = 1;
+    while (table_size < corner_count * 2)
+        table_size <<= 1;
+
+    // every corner could be unique, size for that and shrink into the sfas at the end
+    float *welded = (float *)malloc(sizeof(float) * WELD_FLOATS * corner_count);
+    int *table = (int *)malloc(sizeof(int) * table_size);
+    SU32A **indices = (SU32A **)calloc(model->shape_count, sizeof(SU32A *));
+    if (!welded || !table || !indices)
+    {
+        fprintf(stderr, "Failed to allocate vertex weld tables.\n");
+        free(welded);
+        free(table);
+        free(indices);
+        return false;
+    }
+    memset(table, -1, sizeof(int) * table_size);
+
+    bool ok = true;
+    int vertex_count = 0;
+    for (size_t s = 0; s < model->shape_count && ok; s++)
+    {
+        const Shape *shape = &model->shapes[s];
+        indices[s] = su32a_new(shape->vertex_indices->length);
+        if (!indices[s])
+        {
+            ok = false;
+            break;
+        }
+        for (int c = 0; c < shape->vertex_indices->length; c++)
+        {
+            float key[WELD_FLOATS];
+            corner_key(mesh, shape, c, key);
+            uint32_t slot = key_hash(key) & (table_size - 1);
+            while (table[slot] >= 0 && memcmp(welded + table[slot] * WELD_FLOATS, key, sizeof(key)) != 0)
+                slot = (slot + 1) & (table_size - 1);
+            if (table[slot] < 0)
+            {
+                table[slot] = vertex_count;
+                memcpy(welded + vertex_count * WELD_FLOATS, key, sizeof(key));
+                vertex_count++;
+            }
+            indices[s]->data[c] = table[slot];
+        }
+    }
+
+    SFA *vertices = ok ? sfa_new(vertex_count * 3) : NULL;
+    SFA *texcoords = ok && mesh->texcoords ? sfa_new(vertex_count * 2) : NULL;
+    SFA *normals = ok && mesh->normals ? sfa_new(vertex_count * 3) : NULL;
+    if (!vertices || (mesh->texcoords && !texcoords) || (mesh->normals && !normals))
+    {
+        if (ok)
+            fprintf(stderr, "Failed to allocate welded vertices.\n");
+        else
+            fprintf(stderr, "Failed to allocate welded indices.\n");
+        for (size_t s = 0; s < model->shape_count; s++)
+            if (indices[s])
+                su32a_free(indices[s]);
+        if (vertices)
+            sfa_free(vertices);
+        if (texcoords)
+            sfa_free(texcoords);
+        if (normals)
+            sfa_free(normals);
+        free(welded);
+        free(table);
+        free(indices);
+        return false;
+    }
+
+    for (int i = 0; i < vertex_count; i++)
+    {
+        const float *key = welded + i * WELD_FLOATS;
+        memcpy(vertices->data + i * 3, key, sizeof(float) * 3);
+        if (texcoords)
+            memcpy(texcoords->data + i * 2, key + 3, sizeof(float) * 2);
+        if (normals)
+            memcpy(normals->data + i * 3, key + 5, sizeof(float) * 3);
+    }
+
+    sfa_free(mesh->vertices);
+    mesh->vertices = vertices;
+    if (mesh->texcoords)
+        sfa_free(mesh->texcoords);
+    mesh->texcoords = texcoords;
+    if (mesh->normals)
+        sfa_free(mesh->normals);
+    mesh->normals = normals;
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        Shape *shape = &model->shapes[s];
+        su32a_free(shape->vertex_indices);
+        shape->vertex_indices = indices[s];
+        if (shape->texcoord_indices)
+            su32a_free(shape->texcoord_indices);
+        shape->texcoord_indices = NULL;
+        if (shape->normal_indices)
+            su32a_free(shape->normal_indices);
+        shape->normal_indices = NULL;
+    }
+
+    free(welded);
+    free(table);
+    free(indices);
+    return true;
+}
+
+//////////////////////// TRIANGLE ORDER ////////////////////////
+
+// the scoring from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static float forsyth_vertex_score(int cache_pos, int remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_pos >= 0)
+    {
+        // the last triangle's verts get a fixed score so the next one doesn't just reuse its edge
+        if (cache_pos < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (float)(cache_pos - 3) / (float)(MODEL_VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+    // verts with few triangles left get picked first so they don't end up stranded
+    score += 2.0f * powf((float)remaining, -0.5f);
+    return score;
+}
+
+bool model_optimize_triangle_order(SU32A *indices, int vertex_count)
+{
+    int tri_count = indices->length / 3;
+    if (tri_count < 2)
+        return true;
+
+    int *remaining = (int *)calloc(vertex_count, sizeof(int));
+    int *first_tri = (int *)malloc(sizeof(int) * (vertex_count + 1));
+    int *vertex_tris = (int *)malloc(sizeof(int) * tri_count * 3);
+    int *cache_pos = (int *)malloc(sizeof(int) * vertex_count);
+    float *vertex_score = (float *)malloc(sizeof(float) * vertex_count);
+    float *tri_score = (float *)malloc(sizeof(float) * tri_count);
+    bool *emitted = (bool *)calloc(tri_count, sizeof(bool));
+    uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * tri_count * 3);
+    if (!remaining || !first_tri || !vertex_tris || !cache_pos || !vertex_score || !tri_score || !emitted || !order)
+    {
+        fprintf(stderr, "Failed to allocate triangle order tables.\n");
+        free(remaining);
+        free(first_tri);
+        free(vertex_tris);
+        free(cache_pos);
+        free(vertex_score);
+        free(tri_score);
+        free(emitted);
+        free(order);
+        return false;
+    }
+
+    // triangles using each vertex, packed: vertex v owns vertex_tris[first_tri[v] .. first_tri[v] + remaining[v])
+    for (int i = 0; i < tri_count * 3; i++)
+        remaining[indices->data[i]]++;
+    first_tri[0] = 0;
+    for (int v = 0; v < vertex_count; v++)
+        first_tri[v + 1] = first_tri[v] + remaining[v];
+    memset(remaining, 0, sizeof(int) * vertex_count);
+    for (int i = 0; i < tri_count * 3; i++)
+    {
+        uint32_t v = indices->data[i];
+        vertex_tris[first_tri[v] + remaining[v]++] = i / 3;
+    }
+
+    for (int v = 0; v < vertex_count; v++)
+    {
+        cache_pos[v] = -1;
+        vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+    }
+    for (int t = 0; t < tri_count; t++)
+    {
+        const uint32_t *tri = indices->data + t * 3;
+        tri_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    }
+
+    // the 3 extra slots hold what the newest triangle pushes out, so those verts get rescored too
+    int cache[MODEL_VERTEX_CACHE_SIZE + 3];
+    int cache_len = 0;
+    int best = -1;
+    for (int out = 0; out < tri_count; out++)
+    {
+        // nothing in the cache has triangles left, start a new strip from the best triangle anywhere
+        if (best < 0)
+        {
+            float best_score = -1.0f;
+            for (int t = 0; t < tri_count; t++)
+            {
+                if (!emitted[t] && tri_score[t] > best_score)
+                {
+                    best_score = tri_score[t];
+                    best = t;
+                }
+            }
+        }
+
+        const uint32_t *tri = indices->data + best * 3;
+        memcpy(order + out * 3, tri, sizeof(uint32_t) * 3);
+        emitted[best] = true;
+
+        // take the triangle off its verts' lists
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = tri[k];
+            int *list = vertex_tris + first_tri[v];
+            for (int i = 0; i < remaining[v]; i++)
+            {
+                if (list[i] == best)
+                {
+                    list[i] = list[--remaining[v]];
+                    break;
+                }
+            }
+        }
+
+        // lru: the triangle's verts go to the front, everything else keeps its order behind them
+        int new_cache[MODEL_VERTEX_CACHE_SIZE + 3];
+        int new_len = 0;
+        for (int k = 0; k < 3; k++)
+            new_cache[new_len++] = (int)tri[k];
+        for (int i = 0; i < cache_len; i++)
+        {
+            int v = cache[i];
+            if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+                new_cache[new_len++] = v;
+        }
+        cache_len = new_len;
+        memcpy(cache, new_cache, sizeof(int) * new_len);
+
+        for (int i = 0; i < cache_len; i++)
+        {
+            int v = cache[i];
+            cache_pos[v] = i < MODEL_VERTEX_CACHE_SIZE ? i : -1;
+            vertex_score[v] = forsyth_vertex_score(cache_pos[v], remaining[v]);
+        }
+
+        // rescore the triangles touching the cache, the next one comes from these
+        best = -1;
+        float best_score = -1.0f;
+        for (int i = 0; i < cache_len; i++)
+        {
+            int v = cache[i];
+            const int *list = vertex_tris + first_tri[v];
+            for (int j = 0; j < remaining[v]; j++)
+            {
+                int t = list[j];
+                const uint32_t *other = indices->data + t * 3;
+                tri_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+                if (tri_score[t] > best_score)
+                {
+                    best_score = tri_score[t];
+                    best = t;
+                }
+            }
+        }
+        if (cache_len > MODEL_VERTEX_CACHE_SIZE)
+            cache_len = MODEL_VERTEX_CACHE_SIZE;
+    }
+
+    memcpy(indices->data, order, sizeof(uint32_t) * tri_count * 3);
+    free(remaining);
+    free(first_tri);
+    free(vertex_tris);
+    free(cache_pos);
+    free(vertex_score);
+    free(tri_score);
+    free(emitted);
+    free(order);
+    return true;
+}
+
+//////////////////////// VERTEX ORDER ////////////////////////
+
+bool model_reorder_vertices(Model *model)
+{
+    Mesh *mesh = model->mesh;
+    if (!mesh || !mesh->vertices)
+        return true;
+    // only welded models have one index for all the attributes
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        if (model->shapes[s].texcoord_indices || model->shapes[s].normal_indices)
+            return true;
+    }
+
+    int vertex_count = mesh->vertices->length / 3;
+    int *remap = (int *)malloc(sizeof(int) * vertex_count);
+    SFA *vertices = sfa_new(vertex_count * 3);
+    SFA *texcoords = mesh->texcoords ? sfa_new(vertex_count * 2) : NULL;
+    SFA *normals = mesh->normals ? sfa_new(vertex_count * 3) : NULL;
+    if (!remap || !vertices || (mesh->texcoords && !texcoords) || (mesh->normals && !normals))
+    {
+        fprintf(stderr, "Failed to allocate vertex reorder tables.\n");
+        free(remap);
+        if (vertices)
+            sfa_free(vertices);
+        if (texcoords)
+            sfa_free(texcoords);
+        if (normals)
+            sfa_free(normals);
+        return false;
+    }
+
+    // first use order, anything no shape uses goes at the end.
+    // a shape's coarsest lod goes first, so every level only needs the front of the shape's vertices
+    memset(remap, -1, sizeof(int) * vertex_count);
+    int next = 0;
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        const Shape *shape = &model->shapes[s];
+        for (int l = shape->lod_count - 1; l >= 1; l--)
+        {
+            const SU32A *indices = shape->lods[l].indices;
+            for (int i = 0; i < indices->length; i++)
+            {
+                if (remap[indices->data[i]] < 0)
+                    remap[indices->data[i]] = next++;
+            }
+        }
+        for (int i = 0; i < shape->vertex_indices->length; i++)
+        {
+            if (remap[shape->vertex_indices->data[i]] < 0)
+                remap[shape->vertex_indices->data[i]] = next++;
+        }
+    }
+    for (int v = 0; v < vertex_count; v++)
+    {
+        if (remap[v] < 0)
+            remap[v] = next++;
+    }
+
+    for (int v = 0; v < vertex_count; v++)
+    {
+        int to = remap[v];
+        memcpy(vertices->data + to * 3, mesh->vertices->data + v * 3, sizeof(float) * 3);
+        if (texcoords)
+            memcpy(texcoords->data + to * 2, mesh->texcoords->data + v * 2, sizeof(float) * 2);
+        if (normals)
+            memcpy(normals->data + to * 3, mesh->normals->data + v * 3, sizeof(float) * 3);
+    }
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        Shape *shape = &model->shapes[s];
+        SU32A *indices = shape->vertex_indices;
+        for (int i = 0; i < indices->length; i++)
+            indices->data[i] = remap[indices->data[i]];
+        for (int l = 1; l < shape->lod_count; l++)
+        {
+            indices = shape->lods[l].indices;
+            for (int i = 0; i < indices->length; i++)
+                indices->data[i] = remap[indices->data[i]];
+        }
+    }
+
+    sfa_free(mesh->vertices);
+    mesh->vertices = vertices;
+    if (mesh->texcoords)
+        sfa_free(mesh->texcoords);
+    mesh->texcoords = texcoords;
+    if (mesh->normals)
+        sfa_free(mesh->normals);
+    mesh->normals = normals;
+    free(remap);
+    return true;
+}
+
+//////////////////////// ACMR ////////////////////////
+
+float model_acmr(const Model *model)
+{
+    int cache[MODEL_VERTEX_CACHE_SIZE];
+    int cache_len = 0;
+    int misses = 0;
+    int tri_count = 0;
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        const SU32A *indices = model->shapes[s].vertex_indices;
+        tri_count += indices->length / 3;
+        for (int i = 0; i < indices->length; i++)
+        {
+            int v = (int)indices->data[i];
+            int hit = -1;
+            for (int k = 0; k < cache_len; k++)
+            {
+                if (cache[k] == v)
+                {
+                    hit = k;
+                    break;
+                }
+            }
+            if (hit < 0)
+            {
+                misses++;
+                if (cache_len < MODEL_VERTEX_CACHE_SIZE)
+                    cache_len++;
+                hit = cache_len - 1;
+            }
+            // move to the front
+            memmove(cache + 1, cache, sizeof(int) * hit);
+            cache[0] = v;
+        }
+    }
+    return tri_count ? (float)misses / (float)tri_count : 0.0f;
+}
+
+bool model_optimize(Model *model)
+{
+    if (!model->mesh || !model->mesh->vertices)
+        return true;
+
+    int vertices_before = model->mesh->vertices->length / 3;
+    if (!model_weld_vertices(model))
+        return false;
+    // before welding the indices are raw obj positions, so both acmrs are taken on the welded indices
+    float acmr_before = model_acmr(model);
+    int vertex_count = model->mesh->vertices->length / 3;
+    for (size_t s = 0; s < model->shape_count; s++)
+    {
+        if (!model_optimize_triangle_order(model->shapes[s].vertex_indices, vertex_count))
+            return false;
+    }
+    if (!model_reorder_vertices(model))
+        return false;
+
+    printf("%s: %d -> %d vertices, acmr %.3f -> %.3f\n",
+           model->name ? model->name : "model",
+           vertices_before,
+           vertex_count,
+           acmr_before,
+           model_acmr(model));
+    return true;
+}
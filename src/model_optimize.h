@@ -0,0 +1,35 @@
+#ifndef MODEL_OPTIMIZE_H
+#define MODEL_OPTIMIZE_H
+
+#include <stdbool.h>
+
+#include "model.h"
+#include "su32a.h"
+
+/*
+    Load time clean up of OBJ index data.
+    Welding merges corners with the same position, texcoord and normal into one vertex,
+    after that a shape's vertex_indices index the texcoords and normals too and its
+    texcoord_indices/normal_indices are gone (NULL). Then each shape's triangles get
+    reordered so corners that share a vertex come close together (Forsyth's linear speed
+    vertex cache optimisation), and the vertices are renumbered in first use order so
+    triangle setup walks the transformed vertices front to back.
+*/
+
+// size of the lru cache the optimizer targets and model_acmr simulates
+#define MODEL_VERTEX_CACHE_SIZE 32
+
+// the whole pass, prints vertex counts and the acmr of the welded triangles in load order and reordered.
+// false when a step failed, the model is still fine to draw, just not (fully) optimized
+bool model_optimize(Model *model);
+
+bool model_weld_vertices(Model *model);
+// vertex_count is the size of the vertex pool the indices point into
+bool model_optimize_triangle_order(SU32A *indices, int vertex_count);
+bool model_reorder_vertices(Model *model);
+
+// average cache miss ratio: vertices a lru cache of MODEL_VERTEX_CACHE_SIZE misses per triangle,
+// 3.0 is no reuse at all and 0.5 is about the best a regular grid can do
+float model_acmr(const Model *model);
+
+#endif // MODEL_OPTIMIZE_H
@@ -0,0 +1,242 @@
+#include "occlusion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+#include "vec4.h"
+#include "vertex_stream.h"
+#include "clip.h"
+
+OcclusionBuffer *occlusion_buffer_new(int width, int height, int screen_width, int screen_height)
+{
+    OcclusionBuffer *ob = (OcclusionBuffer *)calloc(1, sizeof(OcclusionBuffer));
+    if (!ob)
+    {
+        fprintf(stderr, "Failed to allocate memory for OcclusionBuffer.\n");
+        return NULL;
+    }
+
+    ob->width = width;
+    ob->height = height;
+    ob->screen_width = screen_width;
+    ob->screen_height = screen_height;
+    ob->depth = (float *)malloc(sizeof(float) * width * height);
+    if (!ob->depth)
+    {
+        fprintf(stderr, "Failed to allocate occlusion depth.\n");
+        occlusion_buffer_free(ob);
+        return NULL;
+    }
+
+    occlusion_buffer_clear(ob);
+    return ob;
+}
+
+void occlusion_buffer_free(OcclusionBuffer *ob)
+{
+    if (!ob)
+    {
+        return;
+    }
+    free(ob->depth);
+    free(ob);
+}
+
+void occlusion_buffer_clear(OcclusionBuffer *ob)
+{
+    for (int i = 0; i < ob->width * ob->height; i++)
+    {
+        ob->depth[i] = FLT_MAX;
+    }
+}
+
+// a x + b y + c, positive on the inside of the edge
+typedef struct
+{
+    float a, b, c;
+} Edge;
+
+static Edge edge_make(float ax, float ay, float bx, float by)
+{
+    Edge e = {-(by - ay), bx - ax, 0.0f};
+    e.c = -(e.a * ax + e.b * ay);
+    return e;
+}
+
+// one screen space triangle at flat depth z, true when it covered at least one cell
+static bool draw_triangle(OcclusionBuffer *ob, Vec2 p0, Vec2 p1, Vec2 p2, float z, CullMode cull_mode)
+{
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+    // same facing rule as triangle setup, positive area is a front face
+    if (area == 0.0f || (cull_mode == CULL_BACK && area < 0.0f) || (cull_mode == CULL_FRONT && area > 0.0f))
+        return false;
+    if (area < 0.0f)
+    {
+        Vec2 swap = p1;
+        p1 = p2;
+        p2 = swap;
+    }
+
+    float scale_x = (float)ob->screen_width / (float)ob->width;
+    float scale_y = (float)ob->screen_height / (float)ob->height;
+    // half the size of a cell in pixels, grown by the margin
+    float half_w = scale_x * 0.5f + OCCLUSION_MARGIN;
+    float half_h = scale_y * 0.5f + OCCLUSION_MARGIN;
+    Edge edges[3] = {
+        edge_make(p0.x, p0.y, p1.x, p1.y),
+        edge_make(p1.x, p1.y, p2.x, p2.y),
+        edge_make(p2.x, p2.y, p0.x, p0.y)};
+    // how far below its value at a cell's center an edge can dip anywhere in the (grown) cell
+    float slack[3];
+    for (int e = 0; e < 3; e++)
+        slack[e] = fabsf(edges[e].a) * half_w + fabsf(edges[e].b) * half_h;
+
+    float min_x = fminf(p0.x, fminf(p1.x, p2.x)), max_x = fmaxf(p0.x, fmaxf(p1.x, p2.x));
+    float min_y = fminf(p0.y, fminf(p1.y, p2.y)), max_y = fmaxf(p0.y, fmaxf(p1.y, p2.y));
+    // most triangles are too small to hold a single grown cell, don't bother walking them
+    if (max_x - min_x <= 2.0f * half_w || max_y - min_y <= 2.0f * half_h)
+        return false;
+    int x0 = (int)fmaxf(floorf(min_x / scale_x), 0.0f);
+    int y0 = (int)fmaxf(floorf(min_y / scale_y), 0.0f);
+    int x1 = (int)fminf(floorf(max_x / scale_x), (float)(ob->width - 1));
+    int y1 = (int)fminf(floorf(max_y / scale_y), (float)(ob->height - 1));
+
+    bool covered = false;
+    for (int y = y0; y <= y1; y++)
+    {
+        // every edge is a line in x along the row, so the covered cells are one span.
+        // the ends get rounded inwards and each cell is still checked, the divides are only for where to look
+        float cy = ((float)y + 0.5f) * scale_y;
+        float lo = (float)x0, hi = (float)x1;
+        for (int e = 0; e < 3; e++)
+        {
+            // a * cx > rest, with cx = (x + 0.5) * scale_x
+            float rest = slack[e] - edges[e].b * cy - edges[e].c;
+            if (edges[e].a > 0.0f)
+                lo = fmaxf(lo, floorf(rest / (edges[e].a * scale_x) - 0.5f));
+            else if (edges[e].a < 0.0f)
+                hi = fminf(hi, ceilf(rest / (edges[e].a * scale_x) - 0.5f));
+            else if (rest >= 0.0f)
+                hi = -1.0f;
+        }
+        lo = fminf(lo, (float)(x1 + 1));
+        hi = fmaxf(hi, (float)(x0 - 1));
+        float *row = ob->depth + y * ob->width;
+        for (int x = (int)lo; x <= (int)hi; x++)
+        {
+            float cx = ((float)x + 0.5f) * scale_x;
+            bool inside = true;
+            for (int e = 0; e < 3 && inside; e++)
+                inside = edges[e].a * cx + edges[e].b * cy + edges[e].c > slack[e];
+            if (inside && z < row[x])
+            {
+                row[x] = z;
+                covered = true;
+            }
+        }
+    }
+    return covered;
+}
+
+int occlusion_buffer_draw(
+    OcclusionBuffer *ob,
+    const VertexCache *vertex_cache,
+    const SU32A *indices,
+    int first_face,
+    int end_face,
+    CullMode cull_mode)
+{
+    const float *screen = vertex_cache->screen->data;
+    const uint8_t *outcodes = vertex_cache->outcodes;
+    int drawn = 0;
+    for (int face = first_face; face < end_face; face++)
+    {
+        const uint32_t *idx = indices->data + face * 3;
+        uint8_t c0 = outcodes[idx[0]], c1 = outcodes[idx[1]], c2 = outcodes[idx[2]];
+        if (c0 & c1 & c2 & CLIP_OUTSIDE)
+            continue;
+
+        // the depths have to come out with the same bits triangle setup gives, so this follows it step by step
+        if (!((c0 | c1 | c2) & (CLIP_NEAR | CLIP_GUARD)))
+        {
+            const float *p0 = screen + idx[0] * 3, *p1 = screen + idx[1] * 3, *p2 = screen + idx[2] * 3;
+            float z = (p0[2] + p1[2] + p2[2]) / 3.0f;
+            drawn += draw_triangle(ob, (Vec2){p0[0], p0[1]}, (Vec2){p1[0], p1[1]}, (Vec2){p2[0], p2[1]}, z, cull_mode);
+            continue;
+        }
+
+        ClipVertex in[3];
+        for (int k = 0; k < 3; k++)
+            in[k] = vertex_cache_clip_vertex(vertex_cache, idx[k]);
+        ClipVertex poly[CLIP_MAX_VERTS];
+        int count = clip_triangle(in, poly, (c0 | c1 | c2) & CLIP_GUARD);
+        if (count < 3)
+            continue;
+        float z = 0.0f;
+        for (int k = 0; k < count; k++)
+            z += poly[k].z;
+        z /= (float)count;
+        // the pieces of the fan each have to cover a cell by themselves
+        bool covered = false;
+        Vec2 first = clip_to_screen(&poly[0], ob->screen_width, ob->screen_height);
+        for (int k = 1; k + 1 < count; k++)
+        {
+            Vec2 p1 = clip_to_screen(&poly[k], ob->screen_width, ob->screen_height);
+            Vec2 p2 = clip_to_screen(&poly[k + 1], ob->screen_width, ob->screen_height);
+            covered |= draw_triangle(ob, first, p1, p2, z, cull_mode);
+        }
+        drawn += covered;
+    }
+    return drawn;
+}
+
+bool occlusion_buffer_box_occluded(const OcclusionBuffer *ob, const Mat4 *mvp, Vec3 min, Vec3 max)
+{
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    // clip z is linear over the box, so its nearest point is one of the corners
+    float near_z = FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        Vec4 p = {i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1.0f};
+        Vec4 clip = mat4_multiply_vec4(*mvp, p);
+        if (clip.w <= 0.0f || clip.z < -clip.w)
+            return false;
+        float sx = (clip.x / clip.w * 0.5f + 0.5f) * (float)ob->screen_width;
+        float sy = (1.0f - (clip.y / clip.w * 0.5f + 0.5f)) * (float)ob->screen_height;
+        min_x = fminf(min_x, sx);
+        max_x = fmaxf(max_x, sx);
+        min_y = fminf(min_y, sy);
+        max_y = fmaxf(max_y, sy);
+        near_z = fminf(near_z, clip.z);
+    }
+
+    // every pixel the box's triangles could land on after the vertex snap, as pixel squares
+    float scale_x = (float)ob->screen_width / (float)ob->width;
+    float scale_y = (float)ob->screen_height / (float)ob->height;
+    float fx0 = floorf((floorf(min_x) - 1.0f) / scale_x);
+    float fy0 = floorf((floorf(min_y) - 1.0f) / scale_y);
+    float fx1 = floorf((floorf(max_x) + 2.0f) / scale_x);
+    float fy1 = floorf((floorf(max_y) + 2.0f) / scale_y);
+    // off screen is the frustum's call
+    if (fx0 > (float)(ob->width - 1) || fy0 > (float)(ob->height - 1) || fx1 < 0.0f || fy1 < 0.0f)
+        return false;
+    int x0 = (int)fmaxf(fx0, 0.0f);
+    int y0 = (int)fmaxf(fy0, 0.0f);
+    int x1 = (int)fminf(fx1, (float)(ob->width - 1));
+    int y1 = (int)fminf(fy1, (float)(ob->height - 1));
+
+    for (int y = y0; y <= y1; y++)
+    {
+        const float *row = ob->depth + y * ob->width;
+        for (int x = x0; x <= x1; x++)
+        {
+            // the z test is z < z_buffer so a tie would be hidden too, but the corners here don't
+            // come out with the exact bits the projection kernels give, ties count as visible
+            if (near_z <= row[x])
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <stdbool.h>
+
+#include "vec3.h"
+#include "mat4.h"
+#include "su32a.h"
+#include "material.h"
+#include "vertex_cache.h"
+
+/*
+    Small software depth buffer for occlusion culling, filled with the big shapes at the
+    start of the frame before anything else gets set up.
+    A cell only takes a triangle's depth when the triangle covers all of it with a couple of
+    pixels to spare (the raster snaps vertices to whole pixels), and the depth is the same flat
+    z triangle setup gives that triangle. So every pixel under a cell ends up in the real z buffer
+    at or in front of the cell, and anything whose nearest point is at or behind every cell it
+    touches can't pass a single z test and gets skipped without being transformed.
+    Occluders have to get drawn exactly as they were put in here: opaque, depth writing, same lod.
+*/
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+// pixels a cell has to be covered past its edges before it counts, 1 for the vertex snap + 1 for the pixel itself
+#define OCCLUSION_MARGIN 2.0f
+
+typedef struct
+{
+    int width;
+    int height;
+    float *depth; // width * height, FLT_MAX where no occluder covers the whole cell
+
+    // size of the screen the vertex caches project to
+    int screen_width;
+    int screen_height;
+} OcclusionBuffer;
+
+OcclusionBuffer *occlusion_buffer_new(int width, int height, int screen_width, int screen_height);
+void occlusion_buffer_free(OcclusionBuffer *ob);
+// call at the top of the frame, with the z buffer clear
+void occlusion_buffer_clear(OcclusionBuffer *ob);
+
+// rasterizes faces [first_face, end_face) of indices, their vertices must be projected in vertex_cache already.
+// returns how many triangles covered at least one cell
+int occlusion_buffer_draw(
+    OcclusionBuffer *ob,
+    const VertexCache *vertex_cache,
+    const SU32A *indices,
+    int first_face,
+    int end_face,
+    CullMode cull_mode);
+
+// true when nothing inside the object space box can show up in front of what the occluders put in the z buffer.
+// boxes reaching past the near plane are never occluded
+bool occlusion_buffer_box_occluded(const OcclusionBuffer *ob, const Mat4 *mvp, Vec3 min, Vec3 max);
+
+#endif // OCCLUSION_H
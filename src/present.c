@@ -0,0 +1,173 @@
+#include "present.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "texture.h"
+
+Presenter *presenter_new(SDL_Window *window, int width, int height, int frame_count)
+{
+    Presenter *presenter = (Presenter *)calloc(1, sizeof(Presenter));
+    if (!presenter)
+    {
+        fprintf(stderr, "Failed to allocate memory for Presenter.\n");
+        return NULL;
+    }
+
+    presenter->window = window;
+    presenter->width = width;
+    presenter->height = height;
+    presenter->renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (!presenter->renderer)
+    {
+        printf("No accelerated renderer (%s), presenting through the window surface\n", SDL_GetError());
+        return presenter;
+    }
+
+    for (int i = 0; i < frame_count && i < RENDER_FRAMES_MAX; i++)
+    {
+        presenter->textures[i] = SDL_CreateTexture(
+            presenter->renderer,
+            SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+            width, height);
+        if (!presenter->textures[i])
+        {
+            fprintf(stderr, "Failed to create frame texture: %s\n", SDL_GetError());
+            presenter_free(presenter);
+            return NULL;
+        }
+    }
+    return presenter;
+}
+
+void presenter_free(Presenter *presenter)
+{
+    if (!presenter)
+    {
+        return;
+    }
+
+    for (int i = 0; i < RENDER_FRAMES_MAX; i++)
+    {
+        if (presenter->textures[i])
+        {
+            if (presenter->locked[i])
+            {
+                SDL_UnlockTexture(presenter->textures[i]);
+            }
+            SDL_DestroyTexture(presenter->textures[i]);
+        }
+        if (presenter->surfaces[i])
+        {
+            SDL_FreeSurface(presenter->surfaces[i]);
+        }
+    }
+    if (presenter->renderer)
+    {
+        SDL_DestroyRenderer(presenter->renderer);
+    }
+    free(presenter);
+}
+
+void presenter_prepare(Presenter *presenter, RenderFrame *frame)
+{
+    SDL_Texture *texture = presenter->textures[frame->index];
+    if (!texture)
+    {
+        render_frame_set_target(frame, NULL, 0);
+        return;
+    }
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0)
+    {
+        fprintf(stderr, "Failed to lock frame texture: %s\n", SDL_GetError());
+        render_frame_set_target(frame, NULL, 0);
+        return;
+    }
+    // rows have to land on whole pixels, otherwise draw into the frame's buffer and upload that
+    if (pitch % (int)sizeof(uint32_t) != 0)
+    {
+        SDL_UnlockTexture(texture);
+        render_frame_set_target(frame, NULL, 0);
+        return;
+    }
+    presenter->locked[frame->index] = true;
+    render_frame_set_target(frame, (uint32_t *)pixels, pitch / (int)sizeof(uint32_t));
+}
+
+static void presenter_show_fps(Presenter *presenter, SDL_Surface *window_surface, TTF_Font *font, int fps)
+{
+    char fpsText[16];
+    snprintf(fpsText, sizeof(fpsText), "FPS: %d", fps);
+    SDL_Color textColor = {255, 255, 255, 255}; // White color
+    SDL_Surface *textSurface = TTF_RenderText_Solid(font, fpsText, textColor);
+    if (!textSurface)
+    {
+        return;
+    }
+    SDL_Rect textRect = {10, 10, textSurface->w, textSurface->h}; // Position in top-left corner
+    if (presenter->renderer)
+    {
+        SDL_Texture *textTexture = SDL_CreateTextureFromSurface(presenter->renderer, textSurface);
+        SDL_RenderCopy(presenter->renderer, textTexture, NULL, &textRect);
+        SDL_DestroyTexture(textTexture);
+    }
+    else
+    {
+        SDL_BlitSurface(textSurface, NULL, window_surface, &textRect);
+    }
+    SDL_FreeSurface(textSurface);
+}
+
+void presenter_show(Presenter *presenter, RenderFrame *frame, TTF_Font *font, int fps)
+{
+    int index = frame->index;
+    if (presenter->renderer)
+    {
+        SDL_Texture *texture = presenter->textures[index];
+        if (presenter->locked[index])
+        {
+            SDL_UnlockTexture(texture);
+            presenter->locked[index] = false;
+        }
+        else
+        {
+            copy_to_texture(frame->texture, texture);
+        }
+        // the texture covers the whole window, nothing to clear first
+        SDL_RenderCopy(presenter->renderer, texture, NULL, NULL);
+        if (font)
+        {
+            presenter_show_fps(presenter, NULL, font, fps);
+        }
+        SDL_RenderPresent(presenter->renderer);
+        return;
+    }
+
+    SDL_Surface *window_surface = SDL_GetWindowSurface(presenter->window);
+    if (!window_surface)
+    {
+        fprintf(stderr, "Failed to get window surface: %s\n", SDL_GetError());
+        return;
+    }
+    // the frame's buffer never moves, so its surface gets made once
+    if (!presenter->surfaces[index])
+    {
+        presenter->surfaces[index] = SDL_CreateRGBSurfaceWithFormatFrom(
+            frame->texture->pixels, presenter->width, presenter->height, 32,
+            frame->texture->stride * (int)sizeof(uint32_t), SDL_PIXELFORMAT_RGBA8888);
+        if (!presenter->surfaces[index])
+        {
+            fprintf(stderr, "Failed to wrap frame buffer: %s\n", SDL_GetError());
+            return;
+        }
+    }
+    SDL_BlitScaled(presenter->surfaces[index], NULL, window_surface, NULL);
+    if (font)
+    {
+        presenter_show_fps(presenter, window_surface, font, fps);
+    }
+    SDL_UpdateWindowSurface(presenter->window);
+}
@@ -0,0 +1,42 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "render_thread.h"
+
+/*
+    Puts finished frames on the window.
+    With a renderer every render frame has a streaming texture of its own. It gets locked before the
+    frame is submitted and the frame is drawn straight into the locked pixels (render_frame_set_target),
+    so showing it is only unlock, stretch over the window, present, with no copy of the framebuffer
+    and no clears since the texture and the window get covered completely. Blending reads back what's
+    under it from there, with RASTER_TILED_FRAMEBUFFER only the resolve's straight row writes touch it.
+    Without an accelerated renderer the frames get scaled straight onto the window surface instead.
+*/
+
+typedef struct
+{
+    SDL_Window *window;
+    SDL_Renderer *renderer;                   // NULL when presenting through the window surface
+    SDL_Texture *textures[RENDER_FRAMES_MAX]; // streaming, one per render frame
+    bool locked[RENDER_FRAMES_MAX];           // the frame is being drawn into its texture
+    SDL_Surface *surfaces[RENDER_FRAMES_MAX]; // window surface path, the frames' own buffers wrapped
+    int width;
+    int height;
+} Presenter;
+
+// width x height is the render size, the frames get stretched over the whole window
+Presenter *presenter_new(SDL_Window *window, int width, int height, int frame_count);
+// the render thread has to be done with every frame first
+void presenter_free(Presenter *presenter);
+
+// points frame at what it gets shown from, call it before submitting the frame
+void presenter_prepare(Presenter *presenter, RenderFrame *frame);
+// puts a finished frame on screen with the fps in the corner, no fps when font is NULL
+void presenter_show(Presenter *presenter, RenderFrame *frame, TTF_Font *font, int fps);
+
+#endif // PRESENT_H
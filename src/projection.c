@@ -67,10 +67,8 @@ void perspective_divide(SFA *transformed_sfa)
             // transformed_sfa->data[i * 4 + 2] /= w;   // z (optional, for depth)
             transformed_sfa->data[i * 4 + 3] = 1.0f; // Set w to 1 after division
         }
-        else
-        {
-            // Handle w == 0 case if necessary
-            // For simplicity, we'll leave the coordinates unchanged
-        }
+        // w == 0 is on the camera plane and has no screen position, x y are left as they are.
+        // the draw path never divides those, vertex_stream_project flags them CLIP_NEAR and
+        // their triangles get clipped (clip.h) before anything is divided
     }
 }
\ No newline at end of file
@@ -0,0 +1,1549 @@
+#include "raster_halfspace.h"
+
+#include <stdbool.h>
+#include <math.h>
+
+#include "hi_z.h"
+#include "simd.h"
+#include "utils.h"
+#include "vec2.h"
+
+// edge values are kept as uint32_t so stepping wraps exactly like the int math in edge_function
+typedef struct
+{
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+    uint32_t e[3]; // edge values at (min_x, min_y), a pixel is inside when all three are <= 0
+    uint32_t step_x[3];
+    uint32_t step_y[3];
+} EdgeSetup;
+
+static inline uint32_t edge_at(IVec2 a, IVec2 b, int px, int py)
+{
+    return (uint32_t)(b.x - a.x) * (uint32_t)(py - a.y) - (uint32_t)(b.y - a.y) * (uint32_t)(px - a.x);
+}
+
+static inline bool edges_inside(uint32_t e0, uint32_t e1, uint32_t e2)
+{
+    return (int32_t)e0 <= 0 && (int32_t)e1 <= 0 && (int32_t)e2 <= 0;
+}
+
+// returns false if there is nothing to draw
+static bool edge_setup(EdgeSetup *es, Triangle t, IRect clip, bool both_windings)
+{
+    IVec2 p[3] = {vec2_to_ivec2(t.p1), vec2_to_ivec2(t.p2), vec2_to_ivec2(t.p3)};
+
+    // Compute bounding box, clipped
+    es->min_x = imax(imin(imin(p[0].x, p[1].x), p[2].x), clip.x);
+    es->min_y = imax(imin(imin(p[0].y, p[1].y), p[2].y), clip.y);
+    es->max_x = imin(imax(imax(p[0].x, p[1].x), p[2].x), clip.x + clip.w - 1);
+    es->max_y = imin(imax(imax(p[0].y, p[1].y), p[2].y), clip.y + clip.h - 1);
+    if (es->min_x > es->max_x || es->min_y > es->max_y)
+        return false;
+
+    // Determine triangle orientation, counter clockwise ones get their edges flipped
+    int32_t area = (int32_t)edge_at(p[0], p[1], p[2].x, p[2].y);
+    bool flip = false;
+    if (area > 0)
+    {
+        if (!both_windings)
+            return false;
+        flip = true;
+    }
+    else if (area == 0 && both_windings)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        IVec2 a = p[i];
+        IVec2 b = p[(i + 1) % 3];
+        es->e[i] = edge_at(a, b, es->min_x, es->min_y);
+        es->step_x[i] = (uint32_t)(a.y - b.y);
+        es->step_y[i] = (uint32_t)(b.x - a.x);
+        if (flip)
+        {
+            es->e[i] = 0u - es->e[i];
+            es->step_x[i] = 0u - es->step_x[i];
+            es->step_y[i] = 0u - es->step_y[i];
+        }
+    }
+    return true;
+}
+
+void raster_uv_setup(UVSetup *uvs, Triangle t, Triangle t_uv)
+{
+    float x1 = t.p1.x, y1 = t.p1.y;
+    float dx2 = t.p2.x - x1, dy2 = t.p2.y - y1;
+    float dx3 = t.p3.x - x1, dy3 = t.p3.y - y1;
+    float denom = dx2 * dy3 - dx3 * dy2;
+    float inv = denom != 0.0f ? 1.0f / denom : 0.0f;
+
+    float du2 = t_uv.p2.x - t_uv.p1.x, du3 = t_uv.p3.x - t_uv.p1.x;
+    float dv2 = t_uv.p2.y - t_uv.p1.y, dv3 = t_uv.p3.y - t_uv.p1.y;
+
+    uvs->u_dx = (du2 * dy3 - du3 * dy2) * inv;
+    uvs->u_dy = (du3 * dx2 - du2 * dx3) * inv;
+    uvs->u_c = t_uv.p1.x - uvs->u_dx * x1 - uvs->u_dy * y1;
+    uvs->v_dx = (dv2 * dy3 - dv3 * dy2) * inv;
+    uvs->v_dy = (dv3 * dx2 - dv2 * dx3) * inv;
+    uvs->v_c = t_uv.p1.y - uvs->v_dx * x1 - uvs->v_dy * y1;
+}
+
+// same math as texture_set_alpha, for 0 < alpha < 255
+static inline uint32_t blend_pixel(uint32_t bg_color, uint32_t color)
+{
+    uint8_t alpha = color & 0xFF;
+    uint8_t inv_alpha = 255 - alpha;
+    uint8_t r = ((color >> 24) & 0xFF) * alpha / 255 + ((bg_color >> 24) & 0xFF) * inv_alpha / 255;
+    uint8_t g = ((color >> 16) & 0xFF) * alpha / 255 + ((bg_color >> 16) & 0xFF) * inv_alpha / 255;
+    uint8_t b = ((color >> 8) & 0xFF) * alpha / 255 + ((bg_color >> 8) & 0xFF) * inv_alpha / 255;
+    return (r << 24) | (g << 16) | (b << 8) | alpha;
+}
+
+static inline int count_bits(unsigned int bits)
+{
+    int n = 0;
+    while (bits)
+    {
+        bits &= bits - 1;
+        n++;
+    }
+    return n;
+}
+
+static inline void put_pixel(uint32_t *dst, uint32_t color)
+{
+    uint8_t alpha = color & 0xFF;
+    if (alpha == 255)
+        *dst = color;
+    else if (alpha > 0)
+        *dst = blend_pixel(*dst, color);
+}
+
+// texture_texel_index, inlined for the samplers
+static inline int texel_index(const Texture *texture, int x, int y)
+{
+    if (texture->layout == TEXTURE_LINEAR)
+        return y * texture->width + x;
+    return (y >> TEXTURE_TILE_SHIFT) * texture->tile_row +
+           ((x >> TEXTURE_TILE_SHIFT) << (TEXTURE_TILE_SHIFT * 2)) +
+           ((y & (TEXTURE_TILE - 1)) << TEXTURE_TILE_SHIFT) +
+           (x & (TEXTURE_TILE - 1));
+}
+
+// same repeat wrap and flip as the fixed point spans of draw_triangle_scanline_with_texture
+static inline uint32_t sample_texture(const Texture *texture, float u, float v)
+{
+    if (u > 1.0f)
+        u = u - (int)u;
+    else if (u < 0.0f)
+        u = 1.0f + u - (int)u;
+    if (v > 1.0f)
+        v = v - (int)v;
+    else if (v < 0.0f)
+        v = 1.0f + v - (int)v;
+
+    float clamped_u = 1.0f - fminf(fmaxf(u, 0.0f), 1.0f);
+    float clamped_v = 1.0f - fminf(fmaxf(v, 0.0f), 1.0f);
+    // a flipped 1.0 is the start of the next repeat
+    int tex_x = (int)(clamped_u * texture->width);
+    int tex_y = (int)(clamped_v * texture->height);
+    if (tex_x >= texture->width)
+        tex_x -= texture->width;
+    if (tex_y >= texture->height)
+        tex_y -= texture->height;
+    return texture->pixels[texel_index(texture, tex_x, tex_y)];
+}
+
+const Texture *raster_uv_mip(const Texture *texture, const UVSetup *uvs)
+{
+    // texels one pixel step moves in x and in y, the longer one picks the level
+    float ux = uvs->u_dx * (float)texture->width, vx = uvs->v_dx * (float)texture->height;
+    float uy = uvs->u_dy * (float)texture->width, vy = uvs->v_dy * (float)texture->height;
+    float rho2 = fmaxf(ux * ux + vx * vx, uy * uy + vy * vy);
+    // every level halves the footprint, stop at the first one where a pixel steps less than 2 texels
+    while (rho2 >= 4.0f && texture->mip)
+    {
+        rho2 *= 0.25f;
+        texture = texture->mip;
+    }
+    return texture;
+}
+
+uint32_t raster_uv_sample(const Texture *texture, const UVSetup *uvs, int x, int y)
+{
+    float u_row = uvs->u_c + uvs->u_dy * (float)y;
+    float v_row = uvs->v_c + uvs->v_dy * (float)y;
+    return sample_texture(texture, u_row + uvs->u_dx * (float)x, v_row + uvs->v_dx * (float)x);
+}
+
+//////////////////////// SCALAR ////////////////////////
+
+static void uv_span_scalar(uint32_t *row, const Texture *texture, const UVSetup *uvs, int y, int x0, int x1)
+{
+    for (int x = x0; x <= x1; x++)
+    {
+        put_pixel(&row[x], raster_uv_sample(texture, uvs, x, y));
+    }
+}
+
+// one pixel of the flat kernel, z_row may be NULL
+static inline void flat_pixel(uint32_t *row, void *z_row, int x, uint32_t color, float z, DepthFormat format)
+{
+    if (z_row)
+    {
+        if (!depth_test(z_row, x, z, format))
+            return;
+        depth_write(z_row, x, z, format);
+    }
+    put_pixel(&row[x], color);
+}
+
+static inline void textured_pixel(uint32_t *row, void *z_row, int x, const Texture *texture, float u, float v, float z, DepthFormat format)
+{
+    if (!depth_test(z_row, x, z, format))
+        return;
+    put_pixel(&row[x], sample_texture(texture, u, v));
+    depth_write(z_row, x, z, format);
+}
+
+// the kernels below take z encoded for the z buffer (see depth_buffer.h) and its format as a constant,
+// they get compiled once per format at the bottom of the file
+
+static inline void flat_scalar(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t color, float z, DepthFormat format)
+{
+    uint32_t e_row[3] = {es->e[0], es->e[1], es->e[2]};
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = z_buffer ? depth_buffer_row(z_buffer, y) : NULL;
+        uint32_t e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+        bool entered = false;
+        for (int x = es->min_x; x <= es->max_x; x++)
+        {
+            if (edges_inside(e0, e1, e2))
+            {
+                entered = true;
+                flat_pixel(row, z_row, x, color, z, format);
+            }
+            else if (entered)
+            {
+                break; // triangles are convex, the rest of the row is outside
+            }
+            e0 += es->step_x[0];
+            e1 += es->step_x[1];
+            e2 += es->step_x[2];
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+static inline void textured_scalar(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, const UVSetup *uvs, const Texture *texture, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    uint32_t e_row[3] = {es->e[0], es->e[1], es->e[2]};
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        float u_row = uvs->u_c + uvs->u_dy * (float)y;
+        float v_row = uvs->v_c + uvs->v_dy * (float)y;
+        uint32_t e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+        bool entered = false;
+        for (int x = es->min_x; x <= es->max_x; x++)
+        {
+            if (edges_inside(e0, e1, e2))
+            {
+                entered = true;
+                if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+                    (*rejected)++;
+                else
+                    textured_pixel(row, z_row, x, texture, u_row + uvs->u_dx * (float)x, v_row + uvs->v_dx * (float)x, z, format);
+            }
+            else if (entered)
+            {
+                break;
+            }
+            e0 += es->step_x[0];
+            e1 += es->step_x[1];
+            e2 += es->step_x[2];
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+static inline void ids_scalar(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t id, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    uint32_t e_row[3] = {es->e[0], es->e[1], es->e[2]};
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *id_row = id_buffer->pixels + y * id_buffer->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        uint32_t e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+        bool entered = false;
+        for (int x = es->min_x; x <= es->max_x; x++)
+        {
+            if (edges_inside(e0, e1, e2))
+            {
+                entered = true;
+                if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+                {
+                    (*rejected)++;
+                }
+                else if (depth_test(z_row, x, z, format))
+                {
+                    id_row[x] = id;
+                    depth_write(z_row, x, z, format);
+                }
+            }
+            else if (entered)
+            {
+                break;
+            }
+            e0 += es->step_x[0];
+            e1 += es->step_x[1];
+            e2 += es->step_x[2];
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+#if SIMD_X86
+
+//////////////////////// SSE2 ////////////////////////
+
+// the depths of the 4 pixels from x as they are stored, u16 ones in the low half
+static inline __m128i depth_load_sse2(const void *z_row, int x, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        return _mm_loadl_epi64((const __m128i *)((const uint16_t *)z_row + x));
+    return _mm_loadu_si128((const __m128i *)((const uint32_t *)z_row + x));
+}
+
+// all ones in the lanes where z passes the z test against depth
+static inline __m128i depth_pass_sse2(__m128i depth, float z, DepthFormat format)
+{
+    // the integer formats stay below 2^31 (u16 ones get zero extended), so signed compares work
+    if (format == DEPTH_FORMAT_U16)
+        return _mm_cmpgt_epi32(_mm_unpacklo_epi16(depth, _mm_setzero_si128()), _mm_set1_epi32((int)z));
+    if (format == DEPTH_FORMAT_U24)
+        return _mm_cmpgt_epi32(depth, _mm_set1_epi32((int)z));
+    return _mm_castps_si128(_mm_cmplt_ps(_mm_set1_ps(z), _mm_castsi128_ps(depth)));
+}
+
+// z in the lanes of mask, the old depth in the rest
+static inline void depth_store_sse2(void *z_row, int x, __m128i depth, __m128i mask, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+    {
+        __m128i mask16 = _mm_packs_epi32(mask, mask);
+        __m128i merged = _mm_or_si128(_mm_and_si128(mask16, _mm_set1_epi16((short)(uint16_t)z)), _mm_andnot_si128(mask16, depth));
+        _mm_storel_epi64((__m128i *)((uint16_t *)z_row + x), merged);
+        return;
+    }
+    __m128i z_v = format == DEPTH_FORMAT_U24 ? _mm_set1_epi32((int)z) : _mm_castps_si128(_mm_set1_ps(z));
+    _mm_storeu_si128((__m128i *)((uint32_t *)z_row + x), _mm_or_si128(_mm_and_si128(mask, z_v), _mm_andnot_si128(mask, depth)));
+}
+
+static inline void flat_sse2(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t color, float z, DepthFormat format)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i offset[3], step4[3];
+    for (int i = 0; i < 3; i++)
+    {
+        uint32_t s = es->step_x[i];
+        offset[i] = _mm_setr_epi32(0, (int)s, (int)(s * 2u), (int)(s * 3u));
+        step4[i] = _mm_set1_epi32((int)(s * 4u));
+    }
+    const __m128i color_v = _mm_set1_epi32((int)color);
+    uint8_t alpha = color & 0xFF;
+
+    uint32_t e_row[3] = {es->e[0], es->e[1], es->e[2]};
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = z_buffer ? depth_buffer_row(z_buffer, y) : NULL;
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32((int)e_row[0]), offset[0]);
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32((int)e_row[1]), offset[1]);
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        int x = es->min_x;
+        for (; x + 3 <= es->max_x; x += 4)
+        {
+            __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(e0, zero), _mm_cmpgt_epi32(e1, zero)), _mm_cmpgt_epi32(e2, zero));
+            e0 = _mm_add_epi32(e0, step4[0]);
+            e1 = _mm_add_epi32(e1, step4[1]);
+            e2 = _mm_add_epi32(e2, step4[2]);
+            int outside_bits = _mm_movemask_ps(_mm_castsi128_ps(outside));
+            if (outside_bits == 0xF)
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            __m128i mask = _mm_andnot_si128(outside, _mm_cmpeq_epi32(zero, zero));
+            if (z_row)
+            {
+                __m128i depth = depth_load_sse2(z_row, x, format);
+                mask = _mm_and_si128(mask, depth_pass_sse2(depth, z, format));
+                depth_store_sse2(z_row, x, depth, mask, z, format);
+            }
+            if (alpha == 255)
+            {
+                __m128i old = _mm_loadu_si128((__m128i *)(row + x));
+                _mm_storeu_si128((__m128i *)(row + x), _mm_or_si128(_mm_and_si128(mask, color_v), _mm_andnot_si128(mask, old)));
+            }
+            else if (alpha > 0)
+            {
+                int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+                for (int k = 0; k < 4; k++)
+                    if (bits & (1 << k))
+                        row[x + k] = blend_pixel(row[x + k], color);
+            }
+        }
+        // leftover pixels at the end of the row
+        if (!(entered && x + 3 <= es->max_x))
+        {
+            uint32_t dx = (uint32_t)(x - es->min_x);
+            uint32_t s0 = e_row[0] + dx * es->step_x[0];
+            uint32_t s1 = e_row[1] + dx * es->step_x[1];
+            uint32_t s2 = e_row[2] + dx * es->step_x[2];
+            for (; x <= es->max_x; x++)
+            {
+                if (edges_inside(s0, s1, s2))
+                    flat_pixel(row, z_row, x, color, z, format);
+                s0 += es->step_x[0];
+                s1 += es->step_x[1];
+                s2 += es->step_x[2];
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+static inline void textured_sse2(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, const UVSetup *uvs, const Texture *texture, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128 lane_f = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128i offset[3], step4[3];
+    for (int i = 0; i < 3; i++)
+    {
+        uint32_t s = es->step_x[i];
+        offset[i] = _mm_setr_epi32(0, (int)s, (int)(s * 2u), (int)(s * 3u));
+        step4[i] = _mm_set1_epi32((int)(s * 4u));
+    }
+    const __m128 u_dx = _mm_set1_ps(uvs->u_dx);
+    const __m128 v_dx = _mm_set1_ps(uvs->v_dx);
+
+    // chunks start on a multiple of 4 so every chunk sits inside one hi-z block
+    const int x_start = es->min_x & ~3;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        float u_row = uvs->u_c + uvs->u_dy * (float)y;
+        float v_row = uvs->v_c + uvs->v_dy * (float)y;
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32((int)e_row[0]), offset[0]);
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32((int)e_row[1]), offset[1]);
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        bool done = false;
+        int x = x_start;
+        for (; x + 3 <= es->max_x; x += 4)
+        {
+            __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(e0, zero), _mm_cmpgt_epi32(e1, zero)), _mm_cmpgt_epi32(e2, zero));
+            outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_set1_epi32(es->min_x - x), lane));
+            e0 = _mm_add_epi32(e0, step4[0]);
+            e1 = _mm_add_epi32(e1, step4[1]);
+            e2 = _mm_add_epi32(e2, step4[2]);
+            int outside_bits = _mm_movemask_ps(_mm_castsi128_ps(outside));
+            if (outside_bits == 0xF)
+            {
+                if (entered)
+                {
+                    done = true;
+                    break;
+                }
+                continue;
+            }
+            entered = true;
+            if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+            {
+                *rejected += count_bits(~outside_bits & 0xF);
+                continue;
+            }
+            __m128i depth = depth_load_sse2(z_row, x, format);
+            int pass = ~outside_bits & _mm_movemask_ps(_mm_castsi128_ps(depth_pass_sse2(depth, z, format))) & 0xF;
+            if (!pass)
+                continue;
+
+            __m128 xf = _mm_add_ps(_mm_set1_ps((float)x), lane_f);
+            float u[4], v[4];
+            _mm_storeu_ps(u, _mm_add_ps(_mm_set1_ps(u_row), _mm_mul_ps(u_dx, xf)));
+            _mm_storeu_ps(v, _mm_add_ps(_mm_set1_ps(v_row), _mm_mul_ps(v_dx, xf)));
+            for (int k = 0; k < 4; k++)
+            {
+                if (pass & (1 << k))
+                {
+                    put_pixel(&row[x + k], sample_texture(texture, u[k], v[k]));
+                    depth_write(z_row, x + k, z, format);
+                }
+            }
+        }
+        // leftover pixels at the end of the row
+        if (!done)
+        {
+            x = imax(x, es->min_x);
+            uint32_t dx = (uint32_t)(x - x_start);
+            uint32_t s0 = e_row[0] + dx * es->step_x[0];
+            uint32_t s1 = e_row[1] + dx * es->step_x[1];
+            uint32_t s2 = e_row[2] + dx * es->step_x[2];
+            for (; x <= es->max_x; x++)
+            {
+                if (edges_inside(s0, s1, s2))
+                {
+                    if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+                        (*rejected)++;
+                    else
+                        textured_pixel(row, z_row, x, texture, u_row + uvs->u_dx * (float)x, v_row + uvs->v_dx * (float)x, z, format);
+                }
+                s0 += es->step_x[0];
+                s1 += es->step_x[1];
+                s2 += es->step_x[2];
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+static inline void ids_sse2(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t id, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i offset[3], step4[3];
+    for (int i = 0; i < 3; i++)
+    {
+        uint32_t s = es->step_x[i];
+        offset[i] = _mm_setr_epi32(0, (int)s, (int)(s * 2u), (int)(s * 3u));
+        step4[i] = _mm_set1_epi32((int)(s * 4u));
+    }
+    const __m128i id_v = _mm_set1_epi32((int)id);
+
+    const int x_start = es->min_x & ~3;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *id_row = id_buffer->pixels + y * id_buffer->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        __m128i e0 = _mm_add_epi32(_mm_set1_epi32((int)e_row[0]), offset[0]);
+        __m128i e1 = _mm_add_epi32(_mm_set1_epi32((int)e_row[1]), offset[1]);
+        __m128i e2 = _mm_add_epi32(_mm_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        bool done = false;
+        int x = x_start;
+        for (; x + 3 <= es->max_x; x += 4)
+        {
+            __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(e0, zero), _mm_cmpgt_epi32(e1, zero)), _mm_cmpgt_epi32(e2, zero));
+            outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_set1_epi32(es->min_x - x), lane));
+            e0 = _mm_add_epi32(e0, step4[0]);
+            e1 = _mm_add_epi32(e1, step4[1]);
+            e2 = _mm_add_epi32(e2, step4[2]);
+            int outside_bits = _mm_movemask_ps(_mm_castsi128_ps(outside));
+            if (outside_bits == 0xF)
+            {
+                if (entered)
+                {
+                    done = true;
+                    break;
+                }
+                continue;
+            }
+            entered = true;
+            if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+            {
+                *rejected += count_bits(~outside_bits & 0xF);
+                continue;
+            }
+            __m128i depth = depth_load_sse2(z_row, x, format);
+            __m128i mask = _mm_andnot_si128(outside, depth_pass_sse2(depth, z, format));
+            depth_store_sse2(z_row, x, depth, mask, z, format);
+            __m128i old = _mm_loadu_si128((__m128i *)(id_row + x));
+            _mm_storeu_si128((__m128i *)(id_row + x), _mm_or_si128(_mm_and_si128(mask, id_v), _mm_andnot_si128(mask, old)));
+        }
+        if (!done)
+        {
+            x = imax(x, es->min_x);
+            uint32_t dx = (uint32_t)(x - x_start);
+            uint32_t s0 = e_row[0] + dx * es->step_x[0];
+            uint32_t s1 = e_row[1] + dx * es->step_x[1];
+            uint32_t s2 = e_row[2] + dx * es->step_x[2];
+            for (; x <= es->max_x; x++)
+            {
+                if (edges_inside(s0, s1, s2))
+                {
+                    if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+                    {
+                        (*rejected)++;
+                    }
+                    else if (depth_test(z_row, x, z, format))
+                    {
+                        id_row[x] = id;
+                        depth_write(z_row, x, z, format);
+                    }
+                }
+                s0 += es->step_x[0];
+                s1 += es->step_x[1];
+                s2 += es->step_x[2];
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+//////////////////////// AVX2 ////////////////////////
+
+/*
+    u16 depths have no masked loads and stores before AVX-512BW, so those read and write all 8
+    pixels of a chunk and blend. chunks start on a multiple of 8 pixels, the rows are padded
+    (see depth_buffer.h) and clip rects start on a multiple of 16, so the 8 never leave the row
+    or reach into another tile's pixels.
+*/
+
+// the depths of the 8 pixels from x as 32 bit lanes, the ones outside mask can be anything
+SIMD_TARGET_AVX2
+static inline __m256i depth_load_avx2(const void *z_row, int x, __m256i mask, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)((const uint16_t *)z_row + x)));
+    if (format == DEPTH_FORMAT_U24)
+        return _mm256_maskload_epi32((const int *)z_row + x, mask);
+    return _mm256_castps_si256(_mm256_maskload_ps((const float *)z_row + x, mask));
+}
+
+// all ones in the lanes where z passes the z test against depth
+SIMD_TARGET_AVX2
+static inline __m256i depth_pass_avx2(__m256i depth, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_F32)
+        return _mm256_castps_si256(_mm256_cmp_ps(_mm256_set1_ps(z), _mm256_castsi256_ps(depth), _CMP_LT_OQ));
+    return _mm256_cmpgt_epi32(depth, _mm256_set1_epi32((int)z));
+}
+
+// z in the lanes of mask
+SIMD_TARGET_AVX2
+static inline void depth_store_avx2(void *z_row, int x, __m256i mask, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+    {
+        __m128i *depth = (__m128i *)((uint16_t *)z_row + x);
+        __m128i mask16 = _mm_packs_epi32(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1));
+        _mm_storeu_si128(depth, _mm_blendv_epi8(_mm_loadu_si128(depth), _mm_set1_epi16((short)(uint16_t)z), mask16));
+    }
+    else if (format == DEPTH_FORMAT_U24)
+    {
+        _mm256_maskstore_epi32((int *)z_row + x, mask, _mm256_set1_epi32((int)z));
+    }
+    else
+    {
+        _mm256_maskstore_ps((float *)z_row + x, mask, _mm256_set1_ps(z));
+    }
+}
+
+SIMD_TARGET_AVX2
+static inline void flat_avx2(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t color, float z, DepthFormat format)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i offset[3], step8[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm256_mullo_epi32(lane, _mm256_set1_epi32((int)es->step_x[i]));
+        step8[i] = _mm256_set1_epi32((int)(es->step_x[i] * 8u));
+    }
+    const __m256i color_v = _mm256_set1_epi32((int)color);
+    uint8_t alpha = color & 0xFF;
+
+    // chunks start on a multiple of 8, for the u16 depths
+    const int x_start = es->min_x & ~7;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = z_buffer ? depth_buffer_row(z_buffer, y) : NULL;
+        __m256i e0 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[0]), offset[0]);
+        __m256i e1 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[1]), offset[1]);
+        __m256i e2 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 8)
+        {
+            __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(e0, zero), _mm256_cmpgt_epi32(e1, zero)), _mm256_cmpgt_epi32(e2, zero));
+            __m256i in_row = _mm256_and_si256(
+                _mm256_cmpgt_epi32(lane, _mm256_set1_epi32(es->min_x - x - 1)),
+                _mm256_cmpgt_epi32(_mm256_set1_epi32(es->max_x - x + 1), lane));
+            __m256i mask = _mm256_andnot_si256(outside, in_row);
+            e0 = _mm256_add_epi32(e0, step8[0]);
+            e1 = _mm256_add_epi32(e1, step8[1]);
+            e2 = _mm256_add_epi32(e2, step8[2]);
+            if (_mm256_testz_si256(mask, mask))
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (z_row)
+            {
+                __m256i depth = depth_load_avx2(z_row, x, mask, format);
+                mask = _mm256_and_si256(mask, depth_pass_avx2(depth, z, format));
+                depth_store_avx2(z_row, x, mask, z, format);
+            }
+            if (alpha == 255)
+            {
+                _mm256_maskstore_epi32((int *)(row + x), mask, color_v);
+            }
+            else if (alpha > 0)
+            {
+                int bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+                for (int k = 0; k < 8; k++)
+                    if (bits & (1 << k))
+                        row[x + k] = blend_pixel(row[x + k], color);
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX2
+static inline __m256 wrap_flip_avx2(__m256 u)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(u));
+    __m256 above = _mm256_sub_ps(u, truncated);
+    __m256 below = _mm256_sub_ps(_mm256_add_ps(one, u), truncated);
+    __m256 wrapped = _mm256_blendv_ps(u, above, _mm256_cmp_ps(u, one, _CMP_GT_OQ));
+    wrapped = _mm256_blendv_ps(wrapped, below, _mm256_cmp_ps(u, zero, _CMP_LT_OQ));
+    return _mm256_sub_ps(one, _mm256_min_ps(_mm256_max_ps(wrapped, zero), one));
+}
+
+SIMD_TARGET_AVX2
+static inline __m256i texel_coord_avx2(__m256 flipped, int size)
+{
+    // a flipped 1.0 is the start of the next repeat
+    __m256i coord = _mm256_cvttps_epi32(_mm256_mul_ps(flipped, _mm256_set1_ps((float)size)));
+    return _mm256_sub_epi32(coord, _mm256_and_si256(_mm256_cmpgt_epi32(coord, _mm256_set1_epi32(size - 1)), _mm256_set1_epi32(size)));
+}
+
+SIMD_TARGET_AVX2
+static inline __m256i texel_index_avx2(const Texture *texture, __m256 u, __m256 v)
+{
+    __m256i tex_x = texel_coord_avx2(u, texture->width);
+    __m256i tex_y = texel_coord_avx2(v, texture->height);
+    if (texture->layout == TEXTURE_LINEAR)
+        return _mm256_add_epi32(_mm256_mullo_epi32(tex_y, _mm256_set1_epi32(texture->width)), tex_x);
+    const __m256i low = _mm256_set1_epi32(TEXTURE_TILE - 1);
+    __m256i tile = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_srli_epi32(tex_y, TEXTURE_TILE_SHIFT), _mm256_set1_epi32(texture->tile_row)),
+        _mm256_slli_epi32(_mm256_srli_epi32(tex_x, TEXTURE_TILE_SHIFT), TEXTURE_TILE_SHIFT * 2));
+    __m256i inner = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(tex_y, low), TEXTURE_TILE_SHIFT), _mm256_and_si256(tex_x, low));
+    return _mm256_or_si256(tile, inner);
+}
+
+SIMD_TARGET_AVX2
+static inline void textured_avx2(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, const UVSetup *uvs, const Texture *texture, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 lane_f = _mm256_cvtepi32_ps(lane);
+    __m256i offset[3], step8[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm256_mullo_epi32(lane, _mm256_set1_epi32((int)es->step_x[i]));
+        step8[i] = _mm256_set1_epi32((int)(es->step_x[i] * 8u));
+    }
+    const __m256 u_dx = _mm256_set1_ps(uvs->u_dx);
+    const __m256 v_dx = _mm256_set1_ps(uvs->v_dx);
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF);
+    const __m256i opaque = _mm256_set1_epi32(0xFF);
+
+    // chunks start on a multiple of 8 so every chunk is exactly one hi-z block wide
+    const int x_start = es->min_x & ~7;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        __m256 u_row = _mm256_set1_ps(uvs->u_c + uvs->u_dy * (float)y);
+        __m256 v_row = _mm256_set1_ps(uvs->v_c + uvs->v_dy * (float)y);
+        __m256i e0 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[0]), offset[0]);
+        __m256i e1 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[1]), offset[1]);
+        __m256i e2 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 8)
+        {
+            __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(e0, zero), _mm256_cmpgt_epi32(e1, zero)), _mm256_cmpgt_epi32(e2, zero));
+            __m256i in_row = _mm256_and_si256(
+                _mm256_cmpgt_epi32(lane, _mm256_set1_epi32(es->min_x - x - 1)),
+                _mm256_cmpgt_epi32(_mm256_set1_epi32(es->max_x - x + 1), lane));
+            __m256i mask = _mm256_andnot_si256(outside, in_row);
+            e0 = _mm256_add_epi32(e0, step8[0]);
+            e1 = _mm256_add_epi32(e1, step8[1]);
+            e2 = _mm256_add_epi32(e2, step8[2]);
+            if (_mm256_testz_si256(mask, mask))
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+            {
+                *rejected += count_bits((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+                continue;
+            }
+
+            __m256i depth = depth_load_avx2(z_row, x, mask, format);
+            mask = _mm256_and_si256(mask, depth_pass_avx2(depth, z, format));
+            if (_mm256_testz_si256(mask, mask))
+                continue;
+
+            __m256 xf = _mm256_add_ps(_mm256_set1_ps((float)x), lane_f);
+            __m256 u = wrap_flip_avx2(_mm256_add_ps(u_row, _mm256_mul_ps(u_dx, xf)));
+            __m256 v = wrap_flip_avx2(_mm256_add_ps(v_row, _mm256_mul_ps(v_dx, xf)));
+            __m256i index = texel_index_avx2(texture, u, v);
+            __m256i texel = _mm256_mask_i32gather_epi32(zero, (const int *)texture->pixels, index, mask, 4);
+
+            __m256i alpha = _mm256_and_si256(texel, alpha_mask);
+            __m256i solid = _mm256_and_si256(mask, _mm256_cmpeq_epi32(alpha, opaque));
+            _mm256_maskstore_epi32((int *)(row + x), solid, texel);
+            depth_store_avx2(z_row, x, mask, z, format);
+
+            // translucent texels are rare, blend them one at a time
+            __m256i translucent = _mm256_andnot_si256(_mm256_or_si256(solid, _mm256_cmpeq_epi32(alpha, zero)), mask);
+            int bits = _mm256_movemask_ps(_mm256_castsi256_ps(translucent));
+            if (bits)
+            {
+                uint32_t texels[8];
+                _mm256_storeu_si256((__m256i *)texels, texel);
+                for (int k = 0; k < 8; k++)
+                    if (bits & (1 << k))
+                        row[x + k] = blend_pixel(row[x + k], texels[k]);
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX2
+static inline void ids_avx2(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t id, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i offset[3], step8[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm256_mullo_epi32(lane, _mm256_set1_epi32((int)es->step_x[i]));
+        step8[i] = _mm256_set1_epi32((int)(es->step_x[i] * 8u));
+    }
+    const __m256i id_v = _mm256_set1_epi32((int)id);
+
+    const int x_start = es->min_x & ~7;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *id_row = id_buffer->pixels + y * id_buffer->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        __m256i e0 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[0]), offset[0]);
+        __m256i e1 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[1]), offset[1]);
+        __m256i e2 = _mm256_add_epi32(_mm256_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 8)
+        {
+            __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(e0, zero), _mm256_cmpgt_epi32(e1, zero)), _mm256_cmpgt_epi32(e2, zero));
+            __m256i in_row = _mm256_and_si256(
+                _mm256_cmpgt_epi32(lane, _mm256_set1_epi32(es->min_x - x - 1)),
+                _mm256_cmpgt_epi32(_mm256_set1_epi32(es->max_x - x + 1), lane));
+            __m256i mask = _mm256_andnot_si256(outside, in_row);
+            e0 = _mm256_add_epi32(e0, step8[0]);
+            e1 = _mm256_add_epi32(e1, step8[1]);
+            e2 = _mm256_add_epi32(e2, step8[2]);
+            if (_mm256_testz_si256(mask, mask))
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (hz_row && !(z < hz_row[x >> HI_Z_FINE_SHIFT]))
+            {
+                *rejected += count_bits((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+                continue;
+            }
+            __m256i depth = depth_load_avx2(z_row, x, mask, format);
+            mask = _mm256_and_si256(mask, depth_pass_avx2(depth, z, format));
+            depth_store_avx2(z_row, x, mask, z, format);
+            _mm256_maskstore_epi32((int *)(id_row + x), mask, id_v);
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX2
+static void uv_span_avx2(uint32_t *row, const Texture *texture, const UVSetup *uvs, int y, int x0, int x1)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 lane_f = _mm256_cvtepi32_ps(lane);
+    const __m256 u_dx = _mm256_set1_ps(uvs->u_dx);
+    const __m256 v_dx = _mm256_set1_ps(uvs->v_dx);
+    const __m256 u_row = _mm256_set1_ps(uvs->u_c + uvs->u_dy * (float)y);
+    const __m256 v_row = _mm256_set1_ps(uvs->v_c + uvs->v_dy * (float)y);
+    const __m256i alpha_mask = _mm256_set1_epi32(0xFF);
+
+    for (int x = x0; x <= x1; x += 8)
+    {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(x1 - x + 1), lane);
+        __m256 xf = _mm256_add_ps(_mm256_set1_ps((float)x), lane_f);
+        __m256 u = wrap_flip_avx2(_mm256_add_ps(u_row, _mm256_mul_ps(u_dx, xf)));
+        __m256 v = wrap_flip_avx2(_mm256_add_ps(v_row, _mm256_mul_ps(v_dx, xf)));
+        __m256i index = texel_index_avx2(texture, u, v);
+        __m256i texel = _mm256_mask_i32gather_epi32(zero, (const int *)texture->pixels, index, mask, 4);
+
+        __m256i alpha = _mm256_and_si256(texel, alpha_mask);
+        __m256i solid = _mm256_and_si256(mask, _mm256_cmpeq_epi32(alpha, alpha_mask));
+        _mm256_maskstore_epi32((int *)(row + x), solid, texel);
+
+        __m256i translucent = _mm256_andnot_si256(_mm256_or_si256(solid, _mm256_cmpeq_epi32(alpha, zero)), mask);
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(translucent));
+        if (bits)
+        {
+            uint32_t texels[8];
+            _mm256_storeu_si256((__m256i *)texels, texel);
+            for (int k = 0; k < 8; k++)
+                if (bits & (1 << k))
+                    row[x + k] = blend_pixel(row[x + k], texels[k]);
+        }
+    }
+}
+
+//////////////////////// AVX-512 ////////////////////////
+
+// the depths of the 16 pixels from x as 32 bit lanes, 0 outside mask for the 32 bit formats.
+// u16 ones load all 16 (chunks start on a multiple of 16, same as the avx2 u16 loads) but store through the mask
+SIMD_TARGET_AVX512
+static inline __m512i depth_load_avx512(const void *z_row, int x, __mmask16 mask, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        return _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)((const uint16_t *)z_row + x)));
+    if (format == DEPTH_FORMAT_U24)
+        return _mm512_maskz_loadu_epi32(mask, (const uint32_t *)z_row + x);
+    return _mm512_castps_si512(_mm512_maskz_loadu_ps(mask, (const float *)z_row + x));
+}
+
+// the lanes of mask where z passes the z test against depth
+SIMD_TARGET_AVX512
+static inline __mmask16 depth_pass_avx512(__mmask16 mask, __m512i depth, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_F32)
+        return _mm512_mask_cmp_ps_mask(mask, _mm512_set1_ps(z), _mm512_castsi512_ps(depth), _CMP_LT_OQ);
+    return _mm512_mask_cmpgt_epi32_mask(mask, depth, _mm512_set1_epi32((int)z));
+}
+
+SIMD_TARGET_AVX512
+static inline void depth_store_avx512(void *z_row, int x, __mmask16 mask, float z, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+        _mm512_mask_cvtepi32_storeu_epi16((uint16_t *)z_row + x, mask, _mm512_set1_epi32((int)z));
+    else if (format == DEPTH_FORMAT_U24)
+        _mm512_mask_storeu_epi32((uint32_t *)z_row + x, mask, _mm512_set1_epi32((int)z));
+    else
+        _mm512_mask_storeu_ps((float *)z_row + x, mask, _mm512_set1_ps(z));
+}
+
+SIMD_TARGET_AVX512
+static inline void flat_avx512(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t color, float z, DepthFormat format)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i offset[3], step16[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm512_mullo_epi32(lane, _mm512_set1_epi32((int)es->step_x[i]));
+        step16[i] = _mm512_set1_epi32((int)(es->step_x[i] * 16u));
+    }
+    const __m512i color_v = _mm512_set1_epi32((int)color);
+    uint8_t alpha = color & 0xFF;
+
+    // chunks start on a multiple of 16, for the u16 depths
+    const int x_start = es->min_x & ~15;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = z_buffer ? depth_buffer_row(z_buffer, y) : NULL;
+        __m512i e0 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[0]), offset[0]);
+        __m512i e1 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[1]), offset[1]);
+        __m512i e2 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 16)
+        {
+            __mmask16 outside = _mm512_cmpgt_epi32_mask(e0, zero) | _mm512_cmpgt_epi32_mask(e1, zero) | _mm512_cmpgt_epi32_mask(e2, zero);
+            __mmask16 in_row = _mm512_cmpgt_epi32_mask(lane, _mm512_set1_epi32(es->min_x - x - 1)) &
+                               _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(es->max_x - x + 1), lane);
+            __mmask16 mask = (__mmask16)(~outside & in_row);
+            e0 = _mm512_add_epi32(e0, step16[0]);
+            e1 = _mm512_add_epi32(e1, step16[1]);
+            e2 = _mm512_add_epi32(e2, step16[2]);
+            if (!mask)
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (z_row)
+            {
+                __m512i depth = depth_load_avx512(z_row, x, mask, format);
+                mask = depth_pass_avx512(mask, depth, z, format);
+                depth_store_avx512(z_row, x, mask, z, format);
+            }
+            if (alpha == 255)
+            {
+                _mm512_mask_storeu_epi32(row + x, mask, color_v);
+            }
+            else if (alpha > 0)
+            {
+                for (int k = 0; k < 16; k++)
+                    if (mask & (1 << k))
+                        row[x + k] = blend_pixel(row[x + k], color);
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX512
+static inline __m512 wrap_flip_avx512(__m512 u)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    __m512 truncated = _mm512_cvtepi32_ps(_mm512_cvttps_epi32(u));
+    __m512 wrapped = _mm512_mask_sub_ps(u, _mm512_cmp_ps_mask(u, one, _CMP_GT_OQ), u, truncated);
+    wrapped = _mm512_mask_sub_ps(wrapped, _mm512_cmp_ps_mask(u, zero, _CMP_LT_OQ), _mm512_add_ps(one, u), truncated);
+    return _mm512_sub_ps(one, _mm512_min_ps(_mm512_max_ps(wrapped, zero), one));
+}
+
+SIMD_TARGET_AVX512
+static inline __m512i texel_coord_avx512(__m512 flipped, int size)
+{
+    // a flipped 1.0 is the start of the next repeat
+    __m512i coord = _mm512_cvttps_epi32(_mm512_mul_ps(flipped, _mm512_set1_ps((float)size)));
+    return _mm512_mask_sub_epi32(coord, _mm512_cmpgt_epi32_mask(coord, _mm512_set1_epi32(size - 1)), coord, _mm512_set1_epi32(size));
+}
+
+SIMD_TARGET_AVX512
+static inline __m512i texel_index_avx512(const Texture *texture, __m512 u, __m512 v)
+{
+    __m512i tex_x = texel_coord_avx512(u, texture->width);
+    __m512i tex_y = texel_coord_avx512(v, texture->height);
+    if (texture->layout == TEXTURE_LINEAR)
+        return _mm512_add_epi32(_mm512_mullo_epi32(tex_y, _mm512_set1_epi32(texture->width)), tex_x);
+    const __m512i low = _mm512_set1_epi32(TEXTURE_TILE - 1);
+    __m512i tile = _mm512_add_epi32(
+        _mm512_mullo_epi32(_mm512_srli_epi32(tex_y, TEXTURE_TILE_SHIFT), _mm512_set1_epi32(texture->tile_row)),
+        _mm512_slli_epi32(_mm512_srli_epi32(tex_x, TEXTURE_TILE_SHIFT), TEXTURE_TILE_SHIFT * 2));
+    __m512i inner = _mm512_or_si512(_mm512_slli_epi32(_mm512_and_si512(tex_y, low), TEXTURE_TILE_SHIFT), _mm512_and_si512(tex_x, low));
+    return _mm512_or_si512(tile, inner);
+}
+
+SIMD_TARGET_AVX512
+static inline void textured_avx512(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, const UVSetup *uvs, const Texture *texture, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 lane_f = _mm512_cvtepi32_ps(lane);
+    __m512i offset[3], step16[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm512_mullo_epi32(lane, _mm512_set1_epi32((int)es->step_x[i]));
+        step16[i] = _mm512_set1_epi32((int)(es->step_x[i] * 16u));
+    }
+    const __m512 u_dx = _mm512_set1_ps(uvs->u_dx);
+    const __m512 v_dx = _mm512_set1_ps(uvs->v_dx);
+    const __m512i alpha_mask = _mm512_set1_epi32(0xFF);
+
+    // chunks start on a multiple of 16 so every chunk covers exactly two hi-z blocks
+    const int x_start = es->min_x & ~15;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *row = pb->pixels + y * pb->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        __m512 u_row = _mm512_set1_ps(uvs->u_c + uvs->u_dy * (float)y);
+        __m512 v_row = _mm512_set1_ps(uvs->v_c + uvs->v_dy * (float)y);
+        __m512i e0 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[0]), offset[0]);
+        __m512i e1 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[1]), offset[1]);
+        __m512i e2 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 16)
+        {
+            __mmask16 outside = _mm512_cmpgt_epi32_mask(e0, zero) | _mm512_cmpgt_epi32_mask(e1, zero) | _mm512_cmpgt_epi32_mask(e2, zero);
+            __mmask16 in_row = _mm512_cmpgt_epi32_mask(lane, _mm512_set1_epi32(es->min_x - x - 1)) &
+                               _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(es->max_x - x + 1), lane);
+            __mmask16 mask = (__mmask16)(~outside & in_row);
+            e0 = _mm512_add_epi32(e0, step16[0]);
+            e1 = _mm512_add_epi32(e1, step16[1]);
+            e2 = _mm512_add_epi32(e2, step16[2]);
+            if (!mask)
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (hz_row)
+            {
+                int block = x >> HI_Z_FINE_SHIFT;
+                __mmask16 keep = 0;
+                if (z < hz_row[block])
+                    keep |= 0x00FF;
+                if (block + 1 < hz->fine_w && z < hz_row[block + 1])
+                    keep |= 0xFF00;
+                *rejected += count_bits(mask & ~keep);
+                mask &= keep;
+                if (!mask)
+                    continue;
+            }
+
+            __m512i depth = depth_load_avx512(z_row, x, mask, format);
+            mask = depth_pass_avx512(mask, depth, z, format);
+            if (!mask)
+                continue;
+
+            __m512 xf = _mm512_add_ps(_mm512_set1_ps((float)x), lane_f);
+            __m512 u = wrap_flip_avx512(_mm512_add_ps(u_row, _mm512_mul_ps(u_dx, xf)));
+            __m512 v = wrap_flip_avx512(_mm512_add_ps(v_row, _mm512_mul_ps(v_dx, xf)));
+            __m512i index = texel_index_avx512(texture, u, v);
+            __m512i texel = _mm512_mask_i32gather_epi32(zero, mask, index, texture->pixels, 4);
+
+            __m512i alpha = _mm512_and_si512(texel, alpha_mask);
+            __mmask16 solid = _mm512_mask_cmpeq_epi32_mask(mask, alpha, alpha_mask);
+            __mmask16 translucent = (__mmask16)(mask & ~solid & ~_mm512_cmpeq_epi32_mask(alpha, zero));
+            _mm512_mask_storeu_epi32(row + x, solid, texel);
+            depth_store_avx512(z_row, x, mask, z, format);
+
+            if (translucent)
+            {
+                uint32_t texels[16];
+                _mm512_storeu_si512(texels, texel);
+                for (int k = 0; k < 16; k++)
+                    if (translucent & (1 << k))
+                        row[x + k] = blend_pixel(row[x + k], texels[k]);
+            }
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX512
+static inline void ids_avx512(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t id, float z, const HiZ *hz, int *rejected, DepthFormat format)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i offset[3], step16[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offset[i] = _mm512_mullo_epi32(lane, _mm512_set1_epi32((int)es->step_x[i]));
+        step16[i] = _mm512_set1_epi32((int)(es->step_x[i] * 16u));
+    }
+    const __m512i id_v = _mm512_set1_epi32((int)id);
+
+    const int x_start = es->min_x & ~15;
+    uint32_t back = (uint32_t)(es->min_x - x_start);
+    uint32_t e_row[3];
+    for (int i = 0; i < 3; i++)
+        e_row[i] = es->e[i] - back * es->step_x[i];
+
+    for (int y = es->min_y; y <= es->max_y; y++)
+    {
+        uint32_t *id_row = id_buffer->pixels + y * id_buffer->stride;
+        void *z_row = depth_buffer_row(z_buffer, y);
+        const float *hz_row = hz ? hz->fine + (y >> HI_Z_FINE_SHIFT) * hz->fine_w : NULL;
+        __m512i e0 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[0]), offset[0]);
+        __m512i e1 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[1]), offset[1]);
+        __m512i e2 = _mm512_add_epi32(_mm512_set1_epi32((int)e_row[2]), offset[2]);
+        bool entered = false;
+        for (int x = x_start; x <= es->max_x; x += 16)
+        {
+            __mmask16 outside = _mm512_cmpgt_epi32_mask(e0, zero) | _mm512_cmpgt_epi32_mask(e1, zero) | _mm512_cmpgt_epi32_mask(e2, zero);
+            __mmask16 in_row = _mm512_cmpgt_epi32_mask(lane, _mm512_set1_epi32(es->min_x - x - 1)) &
+                               _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(es->max_x - x + 1), lane);
+            __mmask16 mask = (__mmask16)(~outside & in_row);
+            e0 = _mm512_add_epi32(e0, step16[0]);
+            e1 = _mm512_add_epi32(e1, step16[1]);
+            e2 = _mm512_add_epi32(e2, step16[2]);
+            if (!mask)
+            {
+                if (entered)
+                    break;
+                continue;
+            }
+            entered = true;
+            if (hz_row)
+            {
+                int block = x >> HI_Z_FINE_SHIFT;
+                __mmask16 keep = 0;
+                if (z < hz_row[block])
+                    keep |= 0x00FF;
+                if (block + 1 < hz->fine_w && z < hz_row[block + 1])
+                    keep |= 0xFF00;
+                *rejected += count_bits(mask & ~keep);
+                mask &= keep;
+                if (!mask)
+                    continue;
+            }
+            __m512i depth = depth_load_avx512(z_row, x, mask, format);
+            mask = depth_pass_avx512(mask, depth, z, format);
+            depth_store_avx512(z_row, x, mask, z, format);
+            _mm512_mask_storeu_epi32(id_row + x, mask, id_v);
+        }
+        e_row[0] += es->step_y[0];
+        e_row[1] += es->step_y[1];
+        e_row[2] += es->step_y[2];
+    }
+}
+
+SIMD_TARGET_AVX512
+static void uv_span_avx512(uint32_t *row, const Texture *texture, const UVSetup *uvs, int y, int x0, int x1)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 lane_f = _mm512_cvtepi32_ps(lane);
+    const __m512 u_dx = _mm512_set1_ps(uvs->u_dx);
+    const __m512 v_dx = _mm512_set1_ps(uvs->v_dx);
+    const __m512 u_row = _mm512_set1_ps(uvs->u_c + uvs->u_dy * (float)y);
+    const __m512 v_row = _mm512_set1_ps(uvs->v_c + uvs->v_dy * (float)y);
+    const __m512i alpha_mask = _mm512_set1_epi32(0xFF);
+
+    for (int x = x0; x <= x1; x += 16)
+    {
+        __mmask16 mask = _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(x1 - x + 1), lane);
+        __m512 xf = _mm512_add_ps(_mm512_set1_ps((float)x), lane_f);
+        __m512 u = wrap_flip_avx512(_mm512_add_ps(u_row, _mm512_mul_ps(u_dx, xf)));
+        __m512 v = wrap_flip_avx512(_mm512_add_ps(v_row, _mm512_mul_ps(v_dx, xf)));
+        __m512i index = texel_index_avx512(texture, u, v);
+        __m512i texel = _mm512_mask_i32gather_epi32(zero, mask, index, texture->pixels, 4);
+
+        __m512i alpha = _mm512_and_si512(texel, alpha_mask);
+        __mmask16 solid = _mm512_mask_cmpeq_epi32_mask(mask, alpha, alpha_mask);
+        __mmask16 translucent = (__mmask16)(mask & ~solid & ~_mm512_cmpeq_epi32_mask(alpha, zero));
+        _mm512_mask_storeu_epi32(row + x, solid, texel);
+        if (translucent)
+        {
+            uint32_t texels[16];
+            _mm512_storeu_si512(texels, texel);
+            for (int k = 0; k < 16; k++)
+                if (translucent & (1 << k))
+                    row[x + k] = blend_pixel(row[x + k], texels[k]);
+        }
+    }
+}
+
+#endif // SIMD_X86
+
+//////////////////////// HI-Z ////////////////////////
+
+static inline bool corner_inside(const EdgeSetup *es, int x, int y)
+{
+    uint32_t dx = (uint32_t)(x - es->min_x);
+    uint32_t dy = (uint32_t)(y - es->min_y);
+    return edges_inside(
+        es->e[0] + dx * es->step_x[0] + dy * es->step_y[0],
+        es->e[1] + dx * es->step_x[1] + dy * es->step_y[1],
+        es->e[2] + dx * es->step_x[2] + dy * es->step_y[2]);
+}
+
+/*
+    every pixel of a block the triangle fully covers now holds z or something closer,
+    so the block max can drop to z. partly covered blocks are left alone.
+    triangles are convex, so a block is covered when its 4 corner pixels are.
+*/
+static void hi_z_lower_covered(HiZ *hz, const EdgeSetup *es, float z)
+{
+    bool lowered = false;
+    for (int by = es->min_y >> HI_Z_FINE_SHIFT; by <= es->max_y >> HI_Z_FINE_SHIFT; by++)
+    {
+        int y0 = by << HI_Z_FINE_SHIFT;
+        int y1 = imin(y0 + HI_Z_FINE_SIZE - 1, hz->height - 1);
+        if (y0 < es->min_y || y1 > es->max_y)
+            continue;
+        for (int bx = es->min_x >> HI_Z_FINE_SHIFT; bx <= es->max_x >> HI_Z_FINE_SHIFT; bx++)
+        {
+            int x0 = bx << HI_Z_FINE_SHIFT;
+            int x1 = imin(x0 + HI_Z_FINE_SIZE - 1, hz->width - 1);
+            if (x0 < es->min_x || x1 > es->max_x)
+                continue;
+            float *block = &hz->fine[by * hz->fine_w + bx];
+            if (!(z < *block))
+                continue;
+            if (corner_inside(es, x0, y0) && corner_inside(es, x1, y0) &&
+                corner_inside(es, x0, y1) && corner_inside(es, x1, y1))
+            {
+                *block = z;
+                lowered = true;
+            }
+        }
+    }
+    if (lowered)
+        hi_z_update_coarse(hz, es->min_x, es->min_y, es->max_x, es->max_y);
+}
+
+//////////////////////// DISPATCH ////////////////////////
+
+#define FLAT_KERNEL(name, kernel, target, format)                                    \
+    target static void name(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, \
+                            uint32_t color, float z)                                 \
+    {                                                                                \
+        kernel(pb, z_buffer, es, color, z, format);                                  \
+    }
+
+#define TEXTURED_KERNEL(name, kernel, target, format)                                                          \
+    target static void name(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es,                           \
+                            const UVSetup *uvs, const Texture *texture, float z, const HiZ *hz, int *rejected) \
+    {                                                                                                          \
+        kernel(pb, z_buffer, es, uvs, texture, z, hz, rejected, format);                                       \
+    }
+
+#define IDS_KERNEL(name, kernel, target, format)                                            \
+    target static void name(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, \
+                            uint32_t id, float z, const HiZ *hz, int *rejected)             \
+    {                                                                                       \
+        kernel(id_buffer, z_buffer, es, id, z, hz, rejected, format);                       \
+    }
+
+// one copy of a kernel per depth format
+#define DEPTH_FORMAT_KERNELS(KERNEL, kernel, target)       \
+    KERNEL(kernel##_f32, kernel, target, DEPTH_FORMAT_F32) \
+    KERNEL(kernel##_u16, kernel, target, DEPTH_FORMAT_U16) \
+    KERNEL(kernel##_u24, kernel, target, DEPTH_FORMAT_U24)
+
+#define DEPTH_FORMAT_ENTRY(kernel) {kernel##_f32, kernel##_u16, kernel##_u24}
+
+typedef void (*FlatKernel)(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t color, float z);
+typedef void (*TexturedKernel)(Texture *pb, DepthBuffer *z_buffer, const EdgeSetup *es, const UVSetup *uvs,
+                               const Texture *texture, float z, const HiZ *hz, int *rejected);
+typedef void (*IdsKernel)(Texture *id_buffer, DepthBuffer *z_buffer, const EdgeSetup *es, uint32_t id, float z, const HiZ *hz, int *rejected);
+
+DEPTH_FORMAT_KERNELS(FLAT_KERNEL, flat_scalar, )
+DEPTH_FORMAT_KERNELS(TEXTURED_KERNEL, textured_scalar, )
+DEPTH_FORMAT_KERNELS(IDS_KERNEL, ids_scalar, )
+#if SIMD_X86
+DEPTH_FORMAT_KERNELS(FLAT_KERNEL, flat_sse2, )
+DEPTH_FORMAT_KERNELS(TEXTURED_KERNEL, textured_sse2, )
+DEPTH_FORMAT_KERNELS(IDS_KERNEL, ids_sse2, )
+DEPTH_FORMAT_KERNELS(FLAT_KERNEL, flat_avx2, SIMD_TARGET_AVX2)
+DEPTH_FORMAT_KERNELS(TEXTURED_KERNEL, textured_avx2, SIMD_TARGET_AVX2)
+DEPTH_FORMAT_KERNELS(IDS_KERNEL, ids_avx2, SIMD_TARGET_AVX2)
+DEPTH_FORMAT_KERNELS(FLAT_KERNEL, flat_avx512, SIMD_TARGET_AVX512)
+DEPTH_FORMAT_KERNELS(TEXTURED_KERNEL, textured_avx512, SIMD_TARGET_AVX512)
+DEPTH_FORMAT_KERNELS(IDS_KERNEL, ids_avx512, SIMD_TARGET_AVX512)
+#endif
+
+// [simd level][depth format], simd_level never goes past scalar without SIMD_X86
+static const FlatKernel flat_kernels[SIMD_LEVEL_AVX512 + 1][DEPTH_FORMAT_COUNT] = {
+    DEPTH_FORMAT_ENTRY(flat_scalar),
+#if SIMD_X86
+    DEPTH_FORMAT_ENTRY(flat_sse2),
+    DEPTH_FORMAT_ENTRY(flat_avx2),
+    DEPTH_FORMAT_ENTRY(flat_avx512),
+#endif
+};
+
+static const TexturedKernel textured_kernels[SIMD_LEVEL_AVX512 + 1][DEPTH_FORMAT_COUNT] = {
+    DEPTH_FORMAT_ENTRY(textured_scalar),
+#if SIMD_X86
+    DEPTH_FORMAT_ENTRY(textured_sse2),
+    DEPTH_FORMAT_ENTRY(textured_avx2),
+    DEPTH_FORMAT_ENTRY(textured_avx512),
+#endif
+};
+
+static const IdsKernel ids_kernels[SIMD_LEVEL_AVX512 + 1][DEPTH_FORMAT_COUNT] = {
+    DEPTH_FORMAT_ENTRY(ids_scalar),
+#if SIMD_X86
+    DEPTH_FORMAT_ENTRY(ids_sse2),
+    DEPTH_FORMAT_ENTRY(ids_avx2),
+    DEPTH_FORMAT_ENTRY(ids_avx512),
+#endif
+};
+
+void raster_halfspace_flat(Texture *pb, Triangle t, uint32_t color)
+{
+    IRect clip = {0, 0, pb->width, pb->height};
+    EdgeSetup es;
+    if ((color & 0xFF) == 0 || !edge_setup(&es, t, clip, false))
+        return;
+    flat_kernels[simd_level()][DEPTH_FORMAT_F32](pb, NULL, &es, color, 0.0f);
+}
+
+void raster_halfspace_flat_z(Texture *pb, DepthBuffer *z_buffer, Triangle t, uint32_t color, float z)
+{
+    IRect clip = {0, 0, pb->width, pb->height};
+    EdgeSetup es;
+    if (!edge_setup(&es, t, clip, false))
+        return;
+    flat_kernels[simd_level()][z_buffer->format](pb, z_buffer, &es, color, depth_buffer_encode(z_buffer, z));
+}
+
+void raster_halfspace_textured(Texture *pb, Texture *texture, DepthBuffer *z_buffer, HiZ *hi_z, HiZCounts *counts, Triangle t, Triangle t_uv, float z, IRect clip)
+{
+    if (!texture)
+        return;
+
+    EdgeSetup es;
+    if (!edge_setup(&es, t, clip, true))
+        return;
+    // hi-z is in the z buffer's units
+    z = depth_buffer_encode(z_buffer, z);
+    if (hi_z)
+    {
+        bool occluded = hi_z_rect_occluded(hi_z, es.min_x, es.min_y, es.max_x, es.max_y, z);
+        if (counts)
+        {
+            counts->triangles_tested++;
+            counts->triangles_rejected += occluded;
+        }
+        if (occluded)
+            return;
+    }
+    UVSetup uvs;
+    raster_uv_setup(&uvs, t, t_uv);
+    const Texture *level = raster_uv_mip(texture, &uvs);
+
+    int rejected = 0;
+    textured_kernels[simd_level()][z_buffer->format](pb, z_buffer, &es, &uvs, level, z, hi_z, &rejected);
+
+    if (hi_z)
+    {
+        if (counts)
+            counts->pixels_rejected += rejected;
+        hi_z_lower_covered(hi_z, &es, z);
+    }
+}
+
+bool raster_halfspace_handles(const Texture *texture, AlphaMode alpha, DepthMode depth)
+{
+    // with every texel at 255 all the alpha modes write the same thing
+    return depth == DEPTH_WRITE && (alpha == ALPHA_BLEND || alpha == ALPHA_AUTO || !texture || texture->alpha == TEXTURE_ALPHA_NONE);
+}
+
+void raster_halfspace_ids(Texture *id_buffer, DepthBuffer *z_buffer, HiZ *hi_z, HiZCounts *counts, Triangle t, uint32_t id, float z, IRect clip)
+{
+    EdgeSetup es;
+    if (!edge_setup(&es, t, clip, true))
+        return;
+    z = depth_buffer_encode(z_buffer, z);
+    if (hi_z)
+    {
+        bool occluded = hi_z_rect_occluded(hi_z, es.min_x, es.min_y, es.max_x, es.max_y, z);
+        if (counts)
+        {
+            counts->triangles_tested++;
+            counts->triangles_rejected += occluded;
+        }
+        if (occluded)
+            return;
+    }
+
+    int rejected = 0;
+    ids_kernels[simd_level()][z_buffer->format](id_buffer, z_buffer, &es, id, z, hi_z, &rejected);
+
+    if (hi_z)
+    {
+        if (counts)
+            counts->pixels_rejected += rejected;
+        hi_z_lower_covered(hi_z, &es, z);
+    }
+}
+
+void raster_uv_span(Texture *pb, const Texture *texture, const UVSetup *uvs, int y, int x0, int x1)
+{
+    uint32_t *row = pb->pixels + y * pb->stride;
+    switch (simd_level())
+    {
+#if SIMD_X86
+    case SIMD_LEVEL_AVX512:
+        uv_span_avx512(row, texture, uvs, y, x0, x1);
+        return;
+    case SIMD_LEVEL_AVX2:
+        uv_span_avx2(row, texture, uvs, y, x0, x1);
+        return;
+#endif
+    default:
+        uv_span_scalar(row, texture, uvs, y, x0, x1);
+        return;
+    }
+}
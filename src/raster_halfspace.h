@@ -0,0 +1,55 @@
+#ifndef RASTER_HALFSPACE_H
+#define RASTER_HALFSPACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "primitives.h"
+#include "texture.h"
+#include "depth_buffer.h"
+#include "hi_z.h"
+#include "material.h"
+
+/*
+    Half-space (edge function) triangle rasterizer.
+    The three edge functions are set up once per triangle and stepped incrementally,
+    4/8/16 pixels are tested at a time with SSE2/AVX2/AVX-512 lanes (picked at runtime, see simd.h)
+    and the covered pixels are written straight into the pixel and depth rows.
+    Vertices are snapped to integer pixels, like draw_triangle always did.
+    z is clip z everywhere here, it gets encoded for the z buffer's format once per triangle
+    and every kernel has a copy for each format (see depth_buffer.h).
+*/
+
+// u(x, y) = u_c + u_dx * x + u_dy * y, same for v
+typedef struct
+{
+    float u_c, u_dx, u_dy;
+    float v_c, v_dx, v_dy;
+} UVSetup;
+
+// only clockwise triangles are drawn, same as draw_triangle
+void raster_halfspace_flat(Texture *pb, Triangle t, uint32_t color);
+// constant z per triangle, z tested and written per pixel
+void raster_halfspace_flat_z(Texture *pb, DepthBuffer *z_buffer, Triangle t, uint32_t color, float z);
+// both windings, affine uvs sampled like draw_triangle_scanline_with_texture, only pixels inside clip are touched.
+// hi_z is optional, when given it is used to skip hidden triangles and pixel blocks, and is kept up to date.
+// what it rejected is added to counts unless that's NULL
+// clip.x should be a multiple of 16 (the kernels read and write whole aligned chunks of 4/8/16 pixels)
+void raster_halfspace_textured(Texture *pb, Texture *texture, DepthBuffer *z_buffer, HiZ *hi_z, HiZCounts *counts, Triangle t, Triangle t_uv, float z, IRect clip);
+// the textured kernels always z test + write and use the ALPHA_BLEND rules,
+// true when that gives the same pixels as alpha and depth would on this texture
+bool raster_halfspace_handles(const Texture *texture, AlphaMode alpha, DepthMode depth);
+// visibility buffer pass: writes id and z for every pixel that passes the z test, no texturing.
+// same coverage and z rules as raster_halfspace_textured, so resolving the ids afterwards gives the same image
+// as long as nothing drawn is see through
+void raster_halfspace_ids(Texture *id_buffer, DepthBuffer *z_buffer, HiZ *hi_z, HiZCounts *counts, Triangle t, uint32_t id, float z, IRect clip);
+
+// screen space uv planes, for shading a pixel after the fact
+void raster_uv_setup(UVSetup *uvs, Triangle t, Triangle t_uv);
+// mip level of texture for the uv derivatives, the base level if it has no mips
+const Texture *raster_uv_mip(const Texture *texture, const UVSetup *uvs);
+uint32_t raster_uv_sample(const Texture *texture, const UVSetup *uvs, int x, int y);
+// textures pixels x0..x1 (inclusive) of row y, both inside pb
+void raster_uv_span(Texture *pb, const Texture *texture, const UVSetup *uvs, int y, int x0, int x1);
+
+#endif // RASTER_HALFSPACE_H
@@ -0,0 +1,77 @@
+#include "render_context.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "simd.h"
+
+// raster tiles are handed out to threads whole, so each one has to own whole hi-z blocks
+_Static_assert(RASTER_TILE_SIZE % HI_Z_COARSE_SIZE == 0, "RASTER_TILE_SIZE must be a multiple of HI_Z_COARSE_SIZE");
+
+RenderContext *render_context_new(int width, int height)
+{
+    RenderContext *render_context = (RenderContext *)calloc(1, sizeof(RenderContext));
+    if (!render_context)
+    {
+        fprintf(stderr, "Failed to allocate memory for RenderContext.\n");
+        return NULL;
+    }
+
+    // detect the simd level up front, before any raster threads read it
+    printf("Raster kernels: %s\n", simd_level_name(simd_level()));
+
+    render_context->tile_raster = tile_raster_new(width, height, RASTER_TILE_SIZE, RASTER_THREADS);
+    if (!render_context->tile_raster)
+    {
+        fprintf(stderr, "Failed to create TileRaster.\n");
+        render_context_free(render_context);
+        return NULL;
+    }
+
+    render_context->frame_arena = arena_new(FRAME_ARENA_SIZE);
+    if (!render_context->frame_arena)
+    {
+        fprintf(stderr, "Failed to create frame arena.\n");
+        render_context_free(render_context);
+        return NULL;
+    }
+
+    if (USE_HI_Z)
+    {
+        render_context->hi_z = hi_z_new(width, height);
+        if (!render_context->hi_z)
+        {
+            fprintf(stderr, "Failed to create HiZ.\n");
+            render_context_free(render_context);
+            return NULL;
+        }
+    }
+
+    if (USE_OCCLUSION_CULLING)
+    {
+        render_context->occlusion = occlusion_buffer_new(OCCLUSION_WIDTH, OCCLUSION_HEIGHT, width, height);
+        if (!render_context->occlusion)
+        {
+            fprintf(stderr, "Failed to create OcclusionBuffer.\n");
+            render_context_free(render_context);
+            return NULL;
+        }
+    }
+
+    return render_context;
+}
+
+void render_context_free(RenderContext *render_context)
+{
+    if (!render_context)
+    {
+        return;
+    }
+
+    tile_raster_free(render_context->tile_raster);
+    hi_z_free(render_context->hi_z);
+    occlusion_buffer_free(render_context->occlusion);
+    arena_free(render_context->frame_arena);
+    free(render_context);
+}
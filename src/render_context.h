@@ -0,0 +1,25 @@
+#ifndef RENDER_CONTEXT_H
+#define RENDER_CONTEXT_H
+
+#include "tile_raster.h"
+#include "hi_z.h"
+#include "arena.h"
+#include "triangle_setup.h"
+#include "frustum.h"
+#include "occlusion.h"
+
+// everything the cpu renderer keeps around between frames
+typedef struct
+{
+    TileRaster *tile_raster;
+    HiZ *hi_z; // NULL when USE_HI_Z is off
+    OcclusionBuffer *occlusion; // NULL when USE_OCCLUSION_CULLING is off
+    Arena *frame_arena; // scratch for one frame, reset at the top of every frame
+    SetupStats setup_stats; // triangle counts for the current frame
+    CullStats cull_stats;   // whole shape counts for the current frame
+} RenderContext;
+
+RenderContext *render_context_new(int width, int height);
+void render_context_free(RenderContext *render_context);
+
+#endif // RENDER_CONTEXT_H
@@ -0,0 +1,233 @@
+#include "render_thread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "globals.h"
+#include "draw.h"
+#include "z_buffer.h"
+#include "utils.h"
+
+static bool frame_queue_init(FrameQueue *q)
+{
+    SDL_AtomicSet(&q->head, 0);
+    SDL_AtomicSet(&q->tail, 0);
+    q->count = SDL_CreateSemaphore(0);
+    return q->count != NULL;
+}
+
+static void frame_queue_destroy(FrameQueue *q)
+{
+    if (q->count)
+    {
+        SDL_DestroySemaphore(q->count);
+    }
+}
+
+// producer side. never full, there are fewer frames than slots
+static void frame_queue_push(FrameQueue *q, RenderFrame *frame)
+{
+    int tail = SDL_AtomicGet(&q->tail);
+    q->slots[tail % FRAME_QUEUE_SIZE] = frame;
+    // the slot has to be written before the consumer can see the new tail
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&q->tail, tail + 1);
+    SDL_SemPost(q->count);
+}
+
+// consumer side, waits for a frame when wait is set and gives NULL when there's none otherwise
+static RenderFrame *frame_queue_pop(FrameQueue *q, bool wait)
+{
+    if (wait)
+        SDL_SemWait(q->count);
+    else if (SDL_SemTryWait(q->count) != 0)
+        return NULL;
+    int head = SDL_AtomicGet(&q->head);
+    // pairs with the release in push, the slot is read after the tail that published it
+    SDL_MemoryBarrierAcquire();
+    RenderFrame *frame = q->slots[head % FRAME_QUEUE_SIZE];
+    SDL_AtomicSet(&q->head, head + 1);
+    return frame;
+}
+
+void render_frame(RenderFrame *frame, Assets *assets, RenderContext *render_context, const Texture *background)
+{
+    arena_reset(render_context->frame_arena);
+    triangle_setup_reset_stats(&render_context->setup_stats);
+    frustum_reset_stats(&render_context->cull_stats);
+    // nothing gets written here, the tiles clear themselves when they're first drawn
+    tile_raster_clear(render_context->tile_raster, frame->texture, frame->z_buffer, render_context->hi_z, background);
+    if (render_context->occlusion)
+    {
+        occlusion_buffer_clear(render_context->occlusion);
+    }
+    // fade_texture(texture, 2);
+    // color_rotate(texture, 10.0);
+    draw(frame->texture, frame->z_buffer, &frame->state, assets, render_context);
+    tile_raster_resolve(render_context->tile_raster);
+    if (SHOW_OCCLUSION_BUFFER && render_context->occlusion)
+    {
+        debug_draw_occlusion_buffer(frame->texture, render_context->occlusion);
+    }
+
+    if (frame->print_stats)
+    {
+        if (SHOW_HI_Z_STATS && render_context->hi_z)
+        {
+            hi_z_print_stats(render_context->hi_z);
+            hi_z_reset_stats(render_context->hi_z);
+        }
+        if (SHOW_SETUP_STATS)
+        {
+            triangle_setup_print_stats(&render_context->setup_stats);
+        }
+        if (SHOW_CULL_STATS)
+        {
+            frustum_print_stats(&render_context->cull_stats);
+        }
+    }
+}
+
+static int render_thread_main(void *data)
+{
+    RenderThread *rt = (RenderThread *)data;
+    while (true)
+    {
+        RenderFrame *frame = frame_queue_pop(&rt->to_render, true);
+        // a NULL frame is the signal to stop
+        if (!frame)
+        {
+            break;
+        }
+        render_frame(frame, rt->assets, rt->render_context, rt->background);
+        frame_queue_push(&rt->to_present, frame);
+    }
+    return 0;
+}
+
+RenderThread *render_thread_new(
+    int width, int height, DepthFormat format, int frame_count, int max_ahead,
+    Assets *assets, RenderContext *render_context, const Texture *background)
+{
+    RenderThread *rt = (RenderThread *)calloc(1, sizeof(RenderThread));
+    if (!rt)
+    {
+        fprintf(stderr, "Failed to allocate memory for RenderThread.\n");
+        return NULL;
+    }
+
+    rt->frame_count = imax(1, imin(frame_count, RENDER_FRAMES_MAX));
+    rt->max_ahead = imax(0, imin(max_ahead, rt->frame_count - 1));
+    rt->assets = assets;
+    rt->render_context = render_context;
+    rt->background = background;
+    for (int i = 0; i < rt->frame_count; i++)
+    {
+        RenderFrame *frame = &rt->frames[i];
+        frame->index = i;
+        frame->buffer = texture_new(width, height);
+        frame->texture = frame->buffer;
+        frame->z_buffer = depth_buffer_new(width, height, format);
+        if (!frame->buffer || !frame->z_buffer)
+        {
+            fprintf(stderr, "Failed to allocate frame buffers.\n");
+            render_thread_free(rt);
+            return NULL;
+        }
+        rt->free_frames[rt->free_count++] = frame;
+    }
+    if (!frame_queue_init(&rt->to_render) || !frame_queue_init(&rt->to_present))
+    {
+        fprintf(stderr, "Failed to create frame queues: %s\n", SDL_GetError());
+        render_thread_free(rt);
+        return NULL;
+    }
+
+    if (rt->frame_count > 1)
+    {
+        rt->thread = SDL_CreateThread(render_thread_main, "render", rt);
+        if (!rt->thread)
+        {
+            // still works, just without the overlap
+            fprintf(stderr, "Failed to create render thread, drawing on the main thread: %s\n", SDL_GetError());
+        }
+    }
+    return rt;
+}
+
+void render_thread_free(RenderThread *rt)
+{
+    if (!rt)
+    {
+        return;
+    }
+
+    if (rt->thread)
+    {
+        frame_queue_push(&rt->to_render, NULL);
+        SDL_WaitThread(rt->thread, NULL);
+    }
+    frame_queue_destroy(&rt->to_render);
+    frame_queue_destroy(&rt->to_present);
+    for (int i = 0; i < rt->frame_count; i++)
+    {
+        if (rt->frames[i].buffer)
+        {
+            texture_free(rt->frames[i].buffer);
+        }
+        depth_buffer_free(rt->frames[i].z_buffer);
+    }
+    free(rt);
+}
+
+void render_frame_set_target(RenderFrame *frame, uint32_t *pixels, int stride)
+{
+    if (!pixels)
+    {
+        frame->texture = frame->buffer;
+        return;
+    }
+    frame->target = *frame->buffer;
+    frame->target.pixels = pixels;
+    frame->target.stride = stride;
+    frame->texture = &frame->target;
+}
+
+RenderFrame *render_thread_acquire(RenderThread *rt)
+{
+    // render_thread_next keeps in_flight at max_ahead or below, so with max_ahead < frame_count there's always one
+    if (rt->free_count == 0)
+    {
+        fprintf(stderr, "No free frame to submit, release the presented ones first.\n");
+        return NULL;
+    }
+    return rt->free_frames[--rt->free_count];
+}
+
+void render_thread_submit(RenderThread *rt, RenderFrame *frame, const State *state, bool print_stats)
+{
+    frame->state = *state;
+    frame->print_stats = print_stats;
+    rt->in_flight++;
+
+    if (!rt->thread)
+    {
+        render_frame(frame, rt->assets, rt->render_context, rt->background);
+    }
+    frame_queue_push(rt->thread ? &rt->to_render : &rt->to_present, frame);
+}
+
+RenderFrame *render_thread_next(RenderThread *rt)
+{
+    if (rt->in_flight == 0)
+    {
+        return NULL;
+    }
+    return frame_queue_pop(&rt->to_present, rt->in_flight > rt->max_ahead);
+}
+
+void render_thread_release(RenderThread *rt, RenderFrame *frame)
+{
+    rt->free_frames[rt->free_count++] = frame;
+    rt->in_flight--;
+}
@@ -0,0 +1,93 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+
+#include "state.h"
+#include "texture.h"
+#include "depth_buffer.h"
+#include "assets.h"
+#include "render_context.h"
+
+/*
+    Draws frames on a thread of its own so presenting one frame overlaps drawing the next.
+    There are a few frames, each a framebuffer + z buffer pair. The main thread hands over a frame
+    with a copy of the state to draw, the render thread draws it and hands it back, and the main
+    thread uploads and presents it and reuses it. The hand overs go through two single producer
+    single consumer rings, one each way, so neither side ever takes a lock. The semaphore next to
+    each ring only counts what's in it so an empty ring can be waited on.
+
+    Everything drawing touches (the assets, the render context) belongs to the render thread from
+    render_thread_new on. With one frame, or when the thread can't be started, render_thread_submit
+    draws the frame right away on the calling thread instead.
+*/
+
+#define RENDER_FRAMES_MAX 3
+
+typedef struct
+{
+    int index;        // in RenderThread frames
+    Texture *texture; // what gets drawn into, buffer or target
+    Texture *buffer;  // the frame's own pixels
+    Texture target;   // view of memory someone else owns, see render_frame_set_target
+    DepthBuffer *z_buffer;
+    State state;      // what to draw, copied from the main thread's state on submit
+    bool print_stats; // print the hi-z / setup / cull stats after drawing
+} RenderFrame;
+
+// the ring capacity is a power of two above RENDER_FRAMES_MAX, so a full ring never looks empty
+#define FRAME_QUEUE_SIZE 4
+
+typedef struct
+{
+    RenderFrame *slots[FRAME_QUEUE_SIZE];
+    SDL_atomic_t head; // next slot to pop, only the consumer moves it
+    SDL_atomic_t tail; // next slot to push, only the producer moves it
+    SDL_sem *count;
+} FrameQueue;
+
+typedef struct
+{
+    RenderFrame frames[RENDER_FRAMES_MAX];
+    int frame_count;
+    int max_ahead; // frames submitted past the one being presented before render_thread_submit waits
+    int in_flight; // submitted and not released yet, main thread only
+
+    // frames the main thread can submit, main thread only
+    RenderFrame *free_frames[RENDER_FRAMES_MAX];
+    int free_count;
+
+    FrameQueue to_render;
+    FrameQueue to_present;
+    SDL_Thread *thread; // NULL when frames get drawn on the submitting thread
+
+    Assets *assets;
+    RenderContext *render_context;
+    const Texture *background;
+} RenderThread;
+
+// frame_count pairs of width x height buffers, clamped to 1..RENDER_FRAMES_MAX. max_ahead is clamped to frame_count - 1
+RenderThread *render_thread_new(
+    int width, int height, DepthFormat format, int frame_count, int max_ahead,
+    Assets *assets, RenderContext *render_context, const Texture *background);
+// finishes whatever is still being drawn and stops the thread
+void render_thread_free(RenderThread *rt);
+
+// a free frame to submit, NULL when every frame is still being drawn or presented
+RenderFrame *render_thread_acquire(RenderThread *rt);
+// hands the acquired frame over to be drawn with state
+void render_thread_submit(RenderThread *rt, RenderFrame *frame, const State *state, bool print_stats);
+// the oldest finished frame. waits for it when max_ahead frames are already waiting behind it, otherwise
+// NULL when it isn't done yet. give it back with render_thread_release once it's presented
+RenderFrame *render_thread_next(RenderThread *rt);
+void render_thread_release(RenderThread *rt, RenderFrame *frame);
+
+// the next time frame gets drawn it goes into pixels, rows stride pixels apart, instead of its own buffer.
+// every pixel gets written and the ones drawn over get read back. NULL pixels goes back to the buffer
+void render_frame_set_target(RenderFrame *frame, uint32_t *pixels, int stride);
+// one whole frame: clear, draw, resolve. what the render thread runs for every frame it gets
+void render_frame(RenderFrame *frame, Assets *assets, RenderContext *render_context, const Texture *background);
+
+#endif // RENDER_THREAD_H
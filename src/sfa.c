@@ -20,6 +20,21 @@ void sfa_free(SFA *sfa)
     free(sfa);
 }
 
+SFA *sfa_new_in(Arena *arena, int length)
+{
+    if (!arena)
+        return sfa_new(length);
+
+    SFA *sfa = (SFA *)arena_alloc(arena, sizeof(SFA));
+    if (!sfa)
+        return NULL;
+    sfa->length = length;
+    sfa->data = (float *)arena_alloc(arena, sizeof(float) * length);
+    if (!sfa->data)
+        return NULL;
+    return sfa;
+}
+
 //////////////////////// TRANSFORM FUNCTIONS ////////////////////////
 
 void sfa_rotate(SFA *sfa, Vec3 rotation)
@@ -148,12 +163,17 @@ SFA *sfa_isometric_projection(const SFA *sfa)
 
 // Applies mvp matrix transformation to input_sfa: (x,y,z) => (x,y,z,1) => (x',y',z',w')
 SFA *sfa_transform_vertices(const SFA *input_sfa, const Mat4 *mvp)
+{
+    return sfa_transform_vertices_in(NULL, input_sfa, mvp);
+}
+
+SFA *sfa_transform_vertices_in(Arena *arena, const SFA *input_sfa, const Mat4 *mvp)
 {
     if (!input_sfa || !mvp)
         return NULL;
 
     int vertex_count = input_sfa->length / 3;
-    SFA *transformed_sfa = sfa_new(vertex_count * 4); // Store as vec4 (homogeneous coordinates)
+    SFA *transformed_sfa = sfa_new_in(arena, vertex_count * 4); // Store as vec4 (homogeneous coordinates)
 
     if (!transformed_sfa)
     {
@@ -3,6 +3,7 @@
 
 #include "vec3.h"
 #include "mat4.h"
+#include "arena.h"
 
 // SFA: Sized Float Array
 typedef struct
@@ -13,6 +14,8 @@ typedef struct
 
 SFA *sfa_new(int length);
 void sfa_free(SFA *sfa);
+// lives in the arena until it is reset, don't sfa_free it. a NULL arena means sfa_new
+SFA *sfa_new_in(Arena *arena, int length);
 
 // same for sized int array
 // SIA: Sized Int Array
@@ -31,6 +34,7 @@ void sfa_scale(SFA *sfa, Vec3 scale);
 void sfa_translate(SFA *sfa, Vec3 translation);
 void sfa_vec3_transform(SFA *sfa, Mat4 transform);
 SFA *sfa_transform_vertices(const SFA *input_sfa, const Mat4 *mvp);
+SFA *sfa_transform_vertices_in(Arena *arena, const SFA *input_sfa, const Mat4 *mvp);
 
 //////////////////////// PROJECTION FUNCTIONS ////////////////////////
 SFA *sfa_orthographic_projection_xy(const SFA *sfa);
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 Shape *shape_new(void)
 {
@@ -16,6 +17,11 @@ Shape *shape_new(void)
     shape->vertex_indices = NULL;
     shape->normal_indices = NULL;
     shape->texcoord_indices = NULL;
+    shape->bounds = bounds_empty();
+    shape->vertex_first = 0;
+    shape->vertex_end = 0;
+    memset(shape->lods, 0, sizeof(shape->lods));
+    shape->lod_count = 0;
     return shape;
 }
 
@@ -43,6 +49,11 @@ void shape_free(Shape *shape)
         {
             su32a_free(shape->texcoord_indices);
         }
+        // level 0 is vertex_indices, already gone
+        for (int i = 1; i < shape->lod_count; i++)
+        {
+            su32a_free(shape->lods[i].indices);
+        }
         free(shape);
     }
 }
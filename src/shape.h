@@ -2,6 +2,18 @@
 #define SHAPE_H
 
 #include "su32a.h"
+#include "bounds.h"
+
+// levels of detail, level 0 is the full shape
+#define SHAPE_MAX_LODS 4
+
+typedef struct
+{
+    SU32A *indices;   // into MeshData->vertices like vertex_indices, level 0 is vertex_indices itself
+    float error;      // object space distance the level can be off from the full shape, 0 for level 0
+    int vertex_first; // indices only point into [vertex_first, vertex_end)
+    int vertex_end;
+} ShapeLod;
 
 // Shape (submesh) struct to hold indices and material info
 typedef struct
@@ -12,6 +24,13 @@ typedef struct
     SU32A *vertex_indices;   // Indices into MeshData->vertices
     SU32A *normal_indices;   // Indices into MeshData->normals
     SU32A *texcoord_indices; // Indices into MeshData->texcoords
+
+    Bounds bounds;    // of the vertices it uses, object space
+    int vertex_first; // vertex_indices only point into [vertex_first, vertex_end)
+    int vertex_end;
+
+    ShapeLod lods[SHAPE_MAX_LODS]; // simpler and simpler versions, see model_build_lods
+    int lod_count;                 // at least 1 once the model is loaded
 } Shape;
 
 Shape *shape_new(void);
@@ -0,0 +1,68 @@
+#include "simd.h"
+
+#include <stdlib.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "globals.h"
+
+static int detected_level = -1;
+
+SimdLevel simd_level(void)
+{
+    // first call happens at startup (render_context_new), after that this is read only
+    if (detected_level < 0)
+    {
+        int level = SIMD_LEVEL_SCALAR;
+        if (SIMD_X86)
+        {
+            if (SDL_HasSSE2())
+                level = SIMD_LEVEL_SSE2;
+            if (SDL_HasAVX2())
+                level = SIMD_LEVEL_AVX2;
+            if (SDL_HasAVX512F())
+                level = SIMD_LEVEL_AVX512;
+        }
+        if (level > SIMD_MAX_LEVEL)
+            level = SIMD_MAX_LEVEL;
+        detected_level = level;
+    }
+    return (SimdLevel)detected_level;
+}
+
+const char *simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_LEVEL_SSE2:
+        return "SSE2";
+    case SIMD_LEVEL_AVX2:
+        return "AVX2";
+    case SIMD_LEVEL_AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+void *simd_alloc(size_t align, size_t size)
+{
+    size = (size + align - 1) & ~(align - 1);
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, align);
+#else
+    return aligned_alloc(align, size);
+#endif
+}
+
+void simd_free(void *ptr)
+{
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
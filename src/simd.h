@@ -0,0 +1,44 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+    cpu feature dispatch for the hand written simd kernels.
+    kernels for wider instruction sets are compiled with a per function target attribute,
+    so the binary still runs on machines without them and picks the widest supported at runtime.
+*/
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
+
+typedef enum
+{
+    SIMD_LEVEL_SCALAR = 0,
+    SIMD_LEVEL_SSE2 = 1,
+    SIMD_LEVEL_AVX2 = 2,
+    SIMD_LEVEL_AVX512 = 3,
+} SimdLevel;
+
+// widest instruction set the cpu supports, capped by SIMD_MAX_LEVEL in globals.h
+SimdLevel simd_level(void);
+const char *simd_level_name(SimdLevel level);
+
+// aligned heap memory for simd loads, msvc has no aligned_alloc so it goes through these.
+// size is rounded up to a multiple of align, free with simd_free
+void *simd_alloc(size_t align, size_t size);
+void simd_free(void *ptr);
+
+#endif // SIMD_H
@@ -0,0 +1,214 @@
+#include "span.h"
+
+#include <math.h>
+
+uint32_t span_fixed_start(float uv, int size)
+{
+    uint32_t period = (uint32_t)size << 16;
+    uint32_t s = (uint32_t)((1.0f - (uv - floorf(uv))) * (float)size * 65536.0f);
+    return s >= period ? s - period : s;
+}
+
+uint32_t span_fixed_step(float uv_step, int size)
+{
+    uint32_t period = (uint32_t)size << 16;
+    float texels = -uv_step * (float)size;
+    texels -= floorf(texels / (float)size) * (float)size;
+    uint32_t ds = (uint32_t)(texels * 65536.0f);
+    return ds >= period ? ds - period : ds;
+}
+
+AlphaMode span_resolve_alpha(AlphaMode mode, const Texture *texture)
+{
+    if (mode != ALPHA_AUTO)
+        return mode;
+    return !texture || texture->alpha == TEXTURE_ALPHA_NONE ? ALPHA_OPAQUE : ALPHA_BLEND;
+}
+
+// same rules as texture_set_alpha
+static inline void blend_pixel(uint32_t *dst, uint32_t color)
+{
+    uint8_t alpha = color & 0xFF;
+    if (alpha == 255)
+    {
+        *dst = color;
+    }
+    else if (alpha > 0)
+    {
+        uint8_t inv_alpha = 255 - alpha;
+        uint32_t bg_color = *dst;
+        uint8_t r = ((color >> 24) & 0xFF) * alpha / 255 + ((bg_color >> 24) & 0xFF) * inv_alpha / 255;
+        uint8_t g = ((color >> 16) & 0xFF) * alpha / 255 + ((bg_color >> 16) & 0xFF) * inv_alpha / 255;
+        uint8_t b = ((color >> 8) & 0xFF) * alpha / 255 + ((bg_color >> 8) & 0xFF) * inv_alpha / 255;
+        *dst = (r << 24) | (g << 16) | (b << 8) | alpha;
+    }
+}
+
+// the z test and the alpha test both come before any write, so a skipped texel leaves z alone too
+static inline void write_pixel(uint32_t *row, void *z_row, int x, uint32_t color, float z, AlphaMode alpha, DepthMode depth, DepthFormat format)
+{
+    if (alpha == ALPHA_TEST && (color & 0xFF) < ALPHA_TEST_REF)
+        return;
+    if (depth == DEPTH_WRITE)
+        depth_write(z_row, x, z, format);
+    if (alpha == ALPHA_BLEND)
+        blend_pixel(&row[x], color);
+    else
+        row[x] = color;
+}
+
+//////////////////////// FLAT ////////////////////////
+
+static inline void flat_span(uint32_t *row, void *z_row, int x0, int x1, uint32_t color, float z, AlphaMode alpha, DepthMode depth, DepthFormat format)
+{
+    for (int x = x0; x <= x1; x++)
+    {
+        if (depth != DEPTH_OFF && !depth_test(z_row, x, z, format))
+            continue;
+        write_pixel(row, z_row, x, color, z, alpha, depth, format);
+    }
+}
+
+#define FLAT_SPAN(name, alpha, depth, format)                                                    \
+    static void name(uint32_t *row, void *z_row, int x0, int x1, uint32_t color, float z) \
+    {                                                                                            \
+        flat_span(row, z_row, x0, x1, color, z, alpha, depth, format);                           \
+    }
+
+// one per depth format
+#define FLAT_SPANS(name, alpha, depth)                   \
+    FLAT_SPAN(name##_f32, alpha, depth, DEPTH_FORMAT_F32) \
+    FLAT_SPAN(name##_u16, alpha, depth, DEPTH_FORMAT_U16) \
+    FLAT_SPAN(name##_u24, alpha, depth, DEPTH_FORMAT_U24)
+
+#define FLAT_SPANS_ENTRY(name) {name##_f32, name##_u16, name##_u24}
+
+FLAT_SPANS(flat_opaque_write, ALPHA_OPAQUE, DEPTH_WRITE)
+FLAT_SPANS(flat_opaque_test, ALPHA_OPAQUE, DEPTH_TEST)
+FLAT_SPANS(flat_opaque_off, ALPHA_OPAQUE, DEPTH_OFF)
+FLAT_SPANS(flat_alpha_test_write, ALPHA_TEST, DEPTH_WRITE)
+FLAT_SPANS(flat_alpha_test_test, ALPHA_TEST, DEPTH_TEST)
+FLAT_SPANS(flat_alpha_test_off, ALPHA_TEST, DEPTH_OFF)
+FLAT_SPANS(flat_blend_write, ALPHA_BLEND, DEPTH_WRITE)
+FLAT_SPANS(flat_blend_test, ALPHA_BLEND, DEPTH_TEST)
+FLAT_SPANS(flat_blend_off, ALPHA_BLEND, DEPTH_OFF)
+
+// [alpha - 1][depth][format]
+static const FlatSpanFn flat_spans[3][3][DEPTH_FORMAT_COUNT] = {
+    {FLAT_SPANS_ENTRY(flat_opaque_write), FLAT_SPANS_ENTRY(flat_opaque_test), FLAT_SPANS_ENTRY(flat_opaque_off)},
+    {FLAT_SPANS_ENTRY(flat_alpha_test_write), FLAT_SPANS_ENTRY(flat_alpha_test_test), FLAT_SPANS_ENTRY(flat_alpha_test_off)},
+    {FLAT_SPANS_ENTRY(flat_blend_write), FLAT_SPANS_ENTRY(flat_blend_test), FLAT_SPANS_ENTRY(flat_blend_off)},
+};
+
+FlatSpanFn span_flat(AlphaMode alpha, DepthMode depth, DepthFormat format)
+{
+    if (alpha == ALPHA_AUTO)
+        alpha = ALPHA_BLEND;
+    return flat_spans[alpha - 1][depth][format];
+}
+
+//////////////////////// TEXTURED ////////////////////////
+
+// power of two levels wrap with a mask, the rest with a compare and subtract
+static inline void textured_span(
+    uint32_t *row, void *z_row, const Texture *level, const FixedSpan *span, int x0, int x1, float z,
+    AlphaMode alpha, DepthMode depth, DepthFormat format, bool pow2, bool tiled)
+{
+    const uint32_t *pixels = level->pixels;
+    const int width = level->width;
+    const uint32_t mask_x = (uint32_t)level->width - 1;
+    const uint32_t mask_y = (uint32_t)level->height - 1;
+    const uint32_t period_s = (uint32_t)level->width << 16;
+    const uint32_t period_t = (uint32_t)level->height << 16;
+    uint32_t s = span->s, t = span->t;
+
+    for (int x = x0; x <= x1; x++)
+    {
+        int tex_x, tex_y;
+        if (pow2)
+        {
+            tex_x = (int)((s >> 16) & mask_x);
+            tex_y = (int)((t >> 16) & mask_y);
+        }
+        else
+        {
+            tex_x = (int)(s >> 16);
+            tex_y = (int)(t >> 16);
+        }
+        s += span->ds;
+        t += span->dt;
+        if (!pow2)
+        {
+            if (s >= period_s)
+                s -= period_s;
+            if (t >= period_t)
+                t -= period_t;
+        }
+
+        if (depth != DEPTH_OFF && !depth_test(z_row, x, z, format))
+            continue;
+        uint32_t color = pixels[tiled ? texture_texel_index(level, tex_x, tex_y) : tex_y * width + tex_x];
+        write_pixel(row, z_row, x, color, z, alpha, depth, format);
+    }
+}
+
+#define TEXTURED_SPAN(name, alpha, depth, format, pow2, tiled)                                                                    \
+    static void name(uint32_t *row, void *z_row, const Texture *level, const FixedSpan *span, int x0, int x1, float z) \
+    {                                                                                                                             \
+        textured_span(row, z_row, level, span, x0, x1, z, alpha, depth, format, pow2, tiled);                                     \
+    }
+
+// all four wrap/addressing variants of one alpha + depth + format
+#define TEXTURED_SPANS_FORMAT(name, alpha, depth, format)                \
+    TEXTURED_SPAN(name##_wrap, alpha, depth, format, false, false)      \
+    TEXTURED_SPAN(name##_pow2, alpha, depth, format, true, false)       \
+    TEXTURED_SPAN(name##_wrap_tiled, alpha, depth, format, false, true) \
+    TEXTURED_SPAN(name##_pow2_tiled, alpha, depth, format, true, true)
+
+// and those for every depth format
+#define TEXTURED_SPANS(name, alpha, depth)                         \
+    TEXTURED_SPANS_FORMAT(name##_f32, alpha, depth, DEPTH_FORMAT_F32) \
+    TEXTURED_SPANS_FORMAT(name##_u16, alpha, depth, DEPTH_FORMAT_U16) \
+    TEXTURED_SPANS_FORMAT(name##_u24, alpha, depth, DEPTH_FORMAT_U24)
+
+#define TEXTURED_SPANS_FORMAT_ENTRY(name) {{name##_wrap, name##_pow2}, {name##_wrap_tiled, name##_pow2_tiled}}
+#define TEXTURED_SPANS_ENTRY(name) \
+    {TEXTURED_SPANS_FORMAT_ENTRY(name##_f32), TEXTURED_SPANS_FORMAT_ENTRY(name##_u16), TEXTURED_SPANS_FORMAT_ENTRY(name##_u24)}
+
+TEXTURED_SPANS(textured_opaque_write, ALPHA_OPAQUE, DEPTH_WRITE)
+TEXTURED_SPANS(textured_opaque_test, ALPHA_OPAQUE, DEPTH_TEST)
+TEXTURED_SPANS(textured_opaque_off, ALPHA_OPAQUE, DEPTH_OFF)
+TEXTURED_SPANS(textured_alpha_test_write, ALPHA_TEST, DEPTH_WRITE)
+TEXTURED_SPANS(textured_alpha_test_test, ALPHA_TEST, DEPTH_TEST)
+TEXTURED_SPANS(textured_alpha_test_off, ALPHA_TEST, DEPTH_OFF)
+TEXTURED_SPANS(textured_blend_write, ALPHA_BLEND, DEPTH_WRITE)
+TEXTURED_SPANS(textured_blend_test, ALPHA_BLEND, DEPTH_TEST)
+TEXTURED_SPANS(textured_blend_off, ALPHA_BLEND, DEPTH_OFF)
+
+// [alpha - 1][depth][format][tiled][pow2]
+static const TexturedSpanFn textured_spans[3][3][DEPTH_FORMAT_COUNT][2][2] = {
+    {
+        TEXTURED_SPANS_ENTRY(textured_opaque_write),
+        TEXTURED_SPANS_ENTRY(textured_opaque_test),
+        TEXTURED_SPANS_ENTRY(textured_opaque_off),
+    },
+    {
+        TEXTURED_SPANS_ENTRY(textured_alpha_test_write),
+        TEXTURED_SPANS_ENTRY(textured_alpha_test_test),
+        TEXTURED_SPANS_ENTRY(textured_alpha_test_off),
+    },
+    {
+        TEXTURED_SPANS_ENTRY(textured_blend_write),
+        TEXTURED_SPANS_ENTRY(textured_blend_test),
+        TEXTURED_SPANS_ENTRY(textured_blend_off),
+    },
+};
+
+TexturedSpanFn span_textured(AlphaMode alpha, DepthMode depth, DepthFormat format, const Texture *level)
+{
+    if (alpha == ALPHA_AUTO)
+        alpha = span_resolve_alpha(alpha, level);
+    bool pow2 = !(level->width & (level->width - 1)) && !(level->height & (level->height - 1));
+    bool tiled = level->layout == TEXTURE_TILED;
+    return textured_spans[alpha - 1][depth][format][tiled][pow2];
+}
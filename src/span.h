@@ -0,0 +1,49 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "texture.h"
+#include "material.h"
+#include "depth_buffer.h"
+
+/*
+    Span writers for the scanline rasterizer.
+    One specialized loop per {opaque, alpha test, alpha blend} x {z test + write, z test, no z}
+    x depth format (and for textures power of two or not, linear or tiled), all built from the same inline
+    bodies with the modes as constants. A triangle picks its writer once, the loops then write
+    straight through row pointers with no bounds checks and no per pixel mode branches,
+    so spans have to be clipped to the buffers before they get here.
+*/
+
+// ALPHA_TEST skips texels with alpha below this
+#define ALPHA_TEST_REF 128
+
+/*
+    uv in 16.16 fixed point texel units for the textured spans.
+    the 1 - uv flip and the scale to the texture size are folded into the start and step,
+    and both are kept wrapped into one period of the texture so they fit in 32 bits.
+    sampling is then repeat wrap: texel = floor((1 - frac(uv)) * size)
+*/
+typedef struct
+{
+    uint32_t s, t;   // texel x, y
+    uint32_t ds, dt; // per pixel step, already wrapped so it's never negative
+} FixedSpan;
+
+uint32_t span_fixed_start(float uv, int size);
+uint32_t span_fixed_step(float uv_step, int size);
+
+// row and z_row point at the start of the row, x0..x1 inclusive. z is encoded for the z buffer's format
+typedef void (*FlatSpanFn)(uint32_t *row, void *z_row, int x0, int x1, uint32_t color, float z);
+typedef void (*TexturedSpanFn)(uint32_t *row, void *z_row, const Texture *level, const FixedSpan *span, int x0, int x1, float z);
+
+// ALPHA_AUTO from the texture: opaque if it has no alpha, blended otherwise. NULL texture counts as opaque
+AlphaMode span_resolve_alpha(AlphaMode mode, const Texture *texture);
+// alpha must be resolved already. z_row may be NULL with DEPTH_OFF
+FlatSpanFn span_flat(AlphaMode alpha, DepthMode depth, DepthFormat format);
+// level is the mip level the spans will sample, its size and layout pick the wrap and addressing
+TexturedSpanFn span_textured(AlphaMode alpha, DepthMode depth, DepthFormat format, const Texture *level);
+
+#endif // SPAN_H
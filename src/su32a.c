@@ -29,6 +29,21 @@ void su32a_free(SU32A *su32a)
     free(su32a);
 }
 
+SU32A *su32a_new_in(Arena *arena, int length)
+{
+    if (!arena)
+        return su32a_new(length);
+
+    SU32A *su32a = (SU32A *)arena_alloc(arena, sizeof(SU32A));
+    if (!su32a)
+        return NULL;
+    su32a->length = length;
+    su32a->data = (uint32_t *)arena_alloc(arena, length * sizeof(uint32_t));
+    if (!su32a->data)
+        return NULL;
+    return su32a;
+}
+
 void su32a_set(SU32A *su32a, int index, uint32_t value)
 {
     if (index < 0 || index >= su32a->length)
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "arena.h"
+
 // SU32A: Sized U32 Array
 typedef struct
 {
@@ -12,6 +14,8 @@ typedef struct
 
 SU32A *su32a_new(int length);
 void su32a_free(SU32A *su32a);
+// lives in the arena until it is reset, don't su32a_free it. a NULL arena means su32a_new
+SU32A *su32a_new_in(Arena *arena, int length);
 
 void su32a_set(SU32A *su32a, int index, uint32_t value);
 uint32_t su32a_get(SU32A *su32a, int index);
@@ -9,6 +9,7 @@
 #include "stb_image.h"
 
 #include "utils.h"
+#include "simd.h"
 
 Texture *texture_new(int width, int height)
 {
@@ -20,6 +21,11 @@ Texture *texture_new(int width, int height)
 
     pb->width = width;
     pb->height = height;
+    pb->stride = width;
+    pb->mip = NULL;
+    pb->layout = TEXTURE_LINEAR;
+    pb->tile_row = 0;
+    pb->alpha = TEXTURE_ALPHA_MIXED;
     pb->pixels = (uint32_t *)calloc(width * height, sizeof(uint32_t));
     if (!pb->pixels)
     {
@@ -32,13 +38,142 @@ Texture *texture_new(int width, int height)
 
 void texture_free(Texture *pb)
 {
-    free(pb->pixels);
-    free(pb);
+    while (pb)
+    {
+        Texture *next = pb->mip;
+        if (pb->layout == TEXTURE_TILED)
+            simd_free(pb->pixels);
+        else
+            free(pb->pixels);
+        free(pb);
+        pb = next;
+    }
+}
+
+// averages a 2x2 block per channel, the edge texel gets reused on odd sized levels
+static Texture *texture_downsample(const Texture *src)
+{
+    int width = src->width > 1 ? src->width / 2 : 1;
+    int height = src->height > 1 ? src->height / 2 : 1;
+    Texture *dst = texture_new(width, height);
+    if (!dst)
+        return NULL;
+
+    for (int y = 0; y < height; y++)
+    {
+        int y0 = imin(y * 2, src->height - 1);
+        int y1 = imin(y * 2 + 1, src->height - 1);
+        for (int x = 0; x < width; x++)
+        {
+            int x0 = imin(x * 2, src->width - 1);
+            int x1 = imin(x * 2 + 1, src->width - 1);
+            uint32_t c[4] = {
+                src->pixels[texture_texel_index(src, x0, y0)],
+                src->pixels[texture_texel_index(src, x1, y0)],
+                src->pixels[texture_texel_index(src, x0, y1)],
+                src->pixels[texture_texel_index(src, x1, y1)]};
+            uint32_t out = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                uint32_t sum = 2; // round to nearest
+                for (int i = 0; i < 4; i++)
+                    sum += (c[i] >> shift) & 0xFF;
+                out |= (sum / 4) << shift;
+            }
+            dst->pixels[y * width + x] = out;
+        }
+    }
+    // cutouts get soft edges once averaged
+    if (src->alpha == TEXTURE_ALPHA_NONE)
+        dst->alpha = TEXTURE_ALPHA_NONE;
+    return dst;
+}
+
+bool texture_build_mips(Texture *texture)
+{
+    texture_free(texture->mip);
+    texture->mip = NULL;
+
+    Texture *level = texture;
+    while (level->width > 1 || level->height > 1)
+    {
+        level->mip = texture_downsample(level);
+        if (!level->mip)
+        {
+            fprintf(stderr, "Failed to allocate mip level of %dx%d texture.\n", level->width, level->height);
+            return false;
+        }
+        level = level->mip;
+    }
+    return true;
+}
+
+int texture_texel_index(const Texture *texture, int x, int y)
+{
+    if (texture->layout == TEXTURE_LINEAR)
+        return y * texture->stride + x;
+    return (y >> TEXTURE_TILE_SHIFT) * texture->tile_row +
+           ((x >> TEXTURE_TILE_SHIFT) << (TEXTURE_TILE_SHIFT * 2)) +
+           ((y & (TEXTURE_TILE - 1)) << TEXTURE_TILE_SHIFT) +
+           (x & (TEXTURE_TILE - 1));
+}
+
+static bool texture_level_set_layout(Texture *level, TextureLayout layout)
+{
+    Texture reordered = *level;
+    reordered.layout = layout;
+    reordered.tile_row = 0;
+    if (layout == TEXTURE_TILED)
+    {
+        // padded out to whole tiles, and cache line aligned so every tile is exactly one line
+        int padded_w = (level->width + TEXTURE_TILE - 1) & ~(TEXTURE_TILE - 1);
+        int padded_h = (level->height + TEXTURE_TILE - 1) & ~(TEXTURE_TILE - 1);
+        reordered.tile_row = padded_w * TEXTURE_TILE;
+        reordered.pixels = (uint32_t *)simd_alloc(64, (size_t)padded_w * padded_h * sizeof(uint32_t));
+        if (reordered.pixels)
+            memset(reordered.pixels, 0, (size_t)padded_w * padded_h * sizeof(uint32_t));
+    }
+    else
+    {
+        reordered.pixels = (uint32_t *)calloc(level->width * level->height, sizeof(uint32_t));
+    }
+    if (!reordered.pixels)
+        return false;
+
+    for (int y = 0; y < level->height; y++)
+    {
+        for (int x = 0; x < level->width; x++)
+        {
+            reordered.pixels[texture_texel_index(&reordered, x, y)] = level->pixels[texture_texel_index(level, x, y)];
+        }
+    }
+
+    if (level->layout == TEXTURE_TILED)
+        simd_free(level->pixels);
+    else
+        free(level->pixels);
+    *level = reordered;
+    return true;
+}
+
+bool texture_set_layout(Texture *texture, TextureLayout layout)
+{
+    for (Texture *level = texture; level; level = level->mip)
+    {
+        if (level->layout == layout)
+            continue;
+        if (!texture_level_set_layout(level, layout))
+        {
+            fprintf(stderr, "Failed to reorder %dx%d texture.\n", level->width, level->height);
+            return false;
+        }
+    }
+    return true;
 }
 
 void copy_to_texture(Texture *pb, SDL_Texture *texture)
 {
-    SDL_UpdateTexture(texture, NULL, pb->pixels, pb->width * sizeof(uint32_t));
+    SDL_UpdateTexture(texture, NULL, pb->pixels, pb->stride * sizeof(uint32_t));
 }
 
 void texture_set(Texture *pb, int x, int y, uint32_t color)
@@ -49,7 +184,7 @@ void texture_set(Texture *pb, int x, int y, uint32_t color)
         printf("x: %d, y: %d\n", x, y);
         return;
     }
-    pb->pixels[y * pb->width + x] = color;
+    pb->pixels[texture_texel_index(pb, x, y)] = color;
 }
 
 void texture_set_alpha(Texture *pb, int x, int y, uint32_t color)
@@ -58,12 +193,13 @@ void texture_set_alpha(Texture *pb, int x, int y, uint32_t color)
     {
         return;
     }
-    uint32_t bg_color = pb->pixels[y * pb->width + x];
+    int index = texture_texel_index(pb, x, y);
+    uint32_t bg_color = pb->pixels[index];
     uint8_t alpha = color & 0xFF;
     if (alpha == 255)
     {
         // Fully opaque, just set the color
-        pb->pixels[y * pb->width + x] = color;
+        pb->pixels[index] = color;
     }
     else if (alpha > 0)
     {
@@ -72,7 +208,7 @@ void texture_set_alpha(Texture *pb, int x, int y, uint32_t color)
         uint8_t r = ((color >> 24) & 0xFF) * alpha / 255 + ((bg_color >> 24) & 0xFF) * inv_alpha / 255;
         uint8_t g = ((color >> 16) & 0xFF) * alpha / 255 + ((bg_color >> 16) & 0xFF) * inv_alpha / 255;
         uint8_t b = ((color >> 8) & 0xFF) * alpha / 255 + ((bg_color >> 8) & 0xFF) * inv_alpha / 255;
-        pb->pixels[y * pb->width + x] = (r << 24) | (g << 16) | (b << 8) | alpha;
+        pb->pixels[index] = (r << 24) | (g << 16) | (b << 8) | alpha;
     }
     // If alpha is 0, do nothing (fully transparent)
 }
@@ -83,7 +219,7 @@ uint32_t texture_get(Texture *pb, int x, int y)
     {
         return 0;
     }
-    return pb->pixels[y * pb->width + x];
+    return pb->pixels[texture_texel_index(pb, x, y)];
 }
 
 void texture_clear(Texture *pb)
@@ -428,16 +564,20 @@ Texture *texture_load_from_png(const char *path)
     }
 
     // Manually set each pixel in RGBA order
+    bool opaque = true, cutout = true;
     for (int i = 0; i < width * height; i++)
     {
         uint8_t r = data[i * 4];
         uint8_t g = data[i * 4 + 1];
         uint8_t b = data[i * 4 + 2];
         uint8_t a = data[i * 4 + 3];
+        opaque = opaque && a == 255;
+        cutout = cutout && (a == 255 || a == 0);
 
         // Set pixel in RGBA order
         buffer->pixels[i] = (r << 24) | (g << 16) | (b << 8) | a;
     }
+    buffer->alpha = opaque ? TEXTURE_ALPHA_NONE : cutout ? TEXTURE_ALPHA_CUTOUT : TEXTURE_ALPHA_MIXED;
 
     stbi_image_free(data);
     return buffer;
@@ -1,6 +1,7 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <SDL2/SDL.h>
@@ -11,15 +12,49 @@
 // Texture
 ////////////////////////////////////////////////////////////////////////////////
 
-typedef struct
+// order of the texels in pixels. framebuffers and anything drawn into stay linear,
+// tiled is for textures that only get sampled, so a step in v stays in the same cache line
+typedef enum
+{
+    TEXTURE_LINEAR, // row major, y * stride + x
+    TEXTURE_TILED,  // 4x4 texel tiles (one 64 byte cache line each), tiles row major
+} TextureLayout;
+
+// what the alpha channel holds. texture_load_from_png looks, anything made another way counts as mixed
+typedef enum
+{
+    TEXTURE_ALPHA_MIXED = 0,
+    TEXTURE_ALPHA_NONE,   // every texel 255
+    TEXTURE_ALPHA_CUTOUT, // every texel 0 or 255
+} TextureAlpha;
+
+#define TEXTURE_TILE_SHIFT 2
+#define TEXTURE_TILE (1 << TEXTURE_TILE_SHIFT)
+
+typedef struct Texture
 {
     int width;
     int height;
+    // pixels from one row to the next in the linear layout. width for everything texture_new makes,
+    // views into someone else's memory (tile_raster's tiles) can differ. the per pixel functions and the
+    // rasterizers go through it, the whole buffer ones (clear, fill, the blits, ...) expect it to be width
+    int stride;
     uint32_t *pixels;
+    struct Texture *mip; // next mip level (half the size), NULL at the end of the chain
+    TextureLayout layout;
+    int tile_row; // texels in one row of tiles, the width padded to the tile size * TEXTURE_TILE. tiled only
+    TextureAlpha alpha;
 } Texture;
 
 Texture *texture_new(int width, int height);
+// frees the mip chain too
 void texture_free(Texture *pb);
+// box filters the chain down to 1x1, replacing any existing one
+bool texture_build_mips(Texture *texture);
+// reorders the texels of the texture and its whole mip chain, build the mips first
+bool texture_set_layout(Texture *texture, TextureLayout layout);
+// where texel x, y lives in pixels for either layout, no bounds check
+int texture_texel_index(const Texture *texture, int x, int y);
 void texture_print(Texture *pb);
 void copy_to_texture(Texture *pb, SDL_Texture *texture);
 
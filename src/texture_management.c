@@ -13,6 +13,7 @@
 #include <gif_lib.h>
 
 #include "texture.h"
+#include "globals.h"
 #include "utils.h"
 
 // Helper function to check if a file has a .png extension (case-insensitive)
@@ -166,6 +167,17 @@ TextureManager *texture_manager_load_from_directory(const char *directory_path)
             }
             free(full_path);
 
+            // minified surfaces sample a smaller level, see raster_uv_mip
+            if (USE_MIPMAPS && !texture_build_mips(loaded_texture))
+            {
+                fprintf(stderr, "Failed to build mips for %s, using the base level only.\n", filename_dup);
+            }
+            // after the mips, they get built from the linear layout
+            if (USE_TILED_TEXTURES && !texture_set_layout(loaded_texture, TEXTURE_TILED))
+            {
+                fprintf(stderr, "Failed to tile %s, sampling it row major.\n", filename_dup);
+            }
+
             // Assign to the next available entry in the array
             texture_manager->entries[current_entry_index].path = path_dup;
             texture_manager->entries[current_entry_index].filename = filename_dup;
@@ -0,0 +1,727 @@
+#include "tile_raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "draw_lib.h"
+#include "globals.h"
+#include "raster_halfspace.h"
+#include "span.h"
+#include "simd.h"
+#include "utils.h"
+
+static void tile_raster_run_tiles(TileRaster *tr);
+static void tile_raster_run(TileRaster *tr);
+
+static int tile_raster_worker(void *data)
+{
+    TileRaster *tr = (TileRaster *)data;
+    while (true)
+    {
+        SDL_SemWait(tr->start_sem);
+        if (tr->quit)
+        {
+            break;
+        }
+        tile_raster_run_tiles(tr);
+        SDL_SemPost(tr->done_sem);
+    }
+    return 0;
+}
+
+TileRaster *tile_raster_new(int width, int height, int tile_size, int num_threads)
+{
+    TileRaster *tr = (TileRaster *)calloc(1, sizeof(TileRaster));
+    if (!tr)
+    {
+        fprintf(stderr, "Failed to allocate memory for TileRaster.\n");
+        return NULL;
+    }
+
+    tr->width = width;
+    tr->height = height;
+    tr->tile_size = tile_size;
+    tr->tiles_x = (width + tile_size - 1) / tile_size;
+    tr->tiles_y = (height + tile_size - 1) / tile_size;
+    tr->bins = (TileBin *)calloc(tr->tiles_x * tr->tiles_y, sizeof(TileBin));
+    // generation starts at 0 and tile_raster_clear bumps it before the first frame, so every tile starts out stale
+    tr->tile_generation = (uint32_t *)calloc(tr->tiles_x * tr->tiles_y, sizeof(uint32_t));
+    if (!tr->bins || !tr->tile_generation)
+    {
+        fprintf(stderr, "Failed to allocate tile bins.\n");
+        free(tr->bins);
+        free(tr->tile_generation);
+        free(tr);
+        return NULL;
+    }
+
+    if (RASTER_VISIBILITY_BUFFER)
+    {
+        tr->id_buffer = texture_new(width, height);
+        if (!tr->id_buffer)
+        {
+            fprintf(stderr, "Failed to allocate visibility buffer.\n");
+            free(tr->bins);
+            free(tr->tile_generation);
+            free(tr);
+            return NULL;
+        }
+    }
+
+    if (num_threads <= 0)
+    {
+        num_threads = SDL_GetCPUCount();
+    }
+    tr->num_threads = imax(num_threads, 1);
+    tr->start_sem = SDL_CreateSemaphore(0);
+    tr->done_sem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&tr->next_tile, 0);
+    tr->quit = false;
+
+    tr->threads = (SDL_Thread **)calloc(tr->num_threads, sizeof(SDL_Thread *));
+    for (int i = 0; i < tr->num_threads - 1; i++)
+    {
+        tr->threads[i] = SDL_CreateThread(tile_raster_worker, "tile_raster", tr);
+        if (!tr->threads[i])
+        {
+            // run with however many workers we managed to start
+            fprintf(stderr, "Failed to create raster thread: %s\n", SDL_GetError());
+            tr->num_threads = i + 1;
+            break;
+        }
+    }
+
+    return tr;
+}
+
+void tile_raster_free(TileRaster *tr)
+{
+    if (!tr)
+    {
+        return;
+    }
+
+    tr->quit = true;
+    for (int i = 0; i < tr->num_threads - 1; i++)
+    {
+        SDL_SemPost(tr->start_sem);
+    }
+    for (int i = 0; i < tr->num_threads - 1; i++)
+    {
+        SDL_WaitThread(tr->threads[i], NULL);
+    }
+    free(tr->threads);
+    SDL_DestroySemaphore(tr->start_sem);
+    SDL_DestroySemaphore(tr->done_sem);
+
+    for (int i = 0; i < tr->tiles_x * tr->tiles_y; i++)
+    {
+        free(tr->bins[i].triangles);
+    }
+    free(tr->bins);
+    free(tr->tile_generation);
+    simd_free(tr->tile_blocks);
+    free(tr->triangles);
+    if (tr->id_buffer)
+    {
+        texture_free(tr->id_buffer);
+    }
+    free(tr->shape_first_face);
+    free(tr->shape_face_count);
+    free(tr->face_triangles);
+    free(tr);
+}
+
+// streaming stores skip the cache, for tiles nobody looks at again until the frame is shown.
+// sse2 only, the stores are what's slow and wider ones don't make them any faster
+static void fill_row(uint32_t *dst, uint32_t value, int count, bool stream)
+{
+    int i = 0;
+#if SIMD_X86
+    if (stream && simd_level() >= SIMD_LEVEL_SSE2)
+    {
+        for (; i < count && ((uintptr_t)(dst + i) & 15); i++)
+            dst[i] = value;
+        __m128i v = _mm_set1_epi32((int)value);
+        for (; i + 4 <= count; i += 4)
+            _mm_stream_si128((__m128i *)(dst + i), v);
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = value;
+}
+
+static void copy_row(uint32_t *dst, const uint32_t *src, int count, bool stream)
+{
+    int i = 0;
+#if SIMD_X86
+    if (stream && simd_level() >= SIMD_LEVEL_SSE2)
+    {
+        for (; i < count && ((uintptr_t)(dst + i) & 15); i++)
+            dst[i] = src[i];
+        for (; i + 4 <= count; i += 4)
+            _mm_stream_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] = src[i];
+}
+
+static IRect tile_raster_tile_rect(const TileRaster *tr, int tile)
+{
+    int tx = tile % tr->tiles_x;
+    int ty = tile / tr->tiles_x;
+    return (IRect){
+        tx * tr->tile_size,
+        ty * tr->tile_size,
+        imin(tr->tile_size, tr->width - tx * tr->tile_size),
+        imin(tr->tile_size, tr->height - ty * tr->tile_size)};
+}
+
+// made again when the depth format changes, in practice that's only on the first clear
+static void tile_raster_alloc_blocks(TileRaster *tr, DepthFormat format)
+{
+    if (tr->tile_blocks && tr->tile_block_format == format)
+        return;
+    simd_free(tr->tile_blocks);
+    size_t pixels = (size_t)tr->tile_size * tr->tile_size;
+    tr->tile_block_size = pixels * (sizeof(uint32_t) + depth_format_size(format));
+    tr->tile_block_format = format;
+    tr->tile_blocks = (uint8_t *)simd_alloc(64, tr->tile_block_size * tr->tiles_x * tr->tiles_y);
+    if (!tr->tile_blocks)
+    {
+        fprintf(stderr, "Failed to allocate tile blocks, drawing straight into the targets.\n");
+    }
+}
+
+// what a tile draws into: the targets themselves, or views of its block when there are tile blocks.
+// the views take the same screen coordinates as the targets, only their rows are tile_size apart
+static void tile_raster_tile_targets(
+    const TileRaster *tr, int tile, Texture *color_view, DepthBuffer *depth_view, Texture **pb, DepthBuffer **z_buffer)
+{
+    if (!tr->tile_blocks)
+    {
+        *pb = tr->pb;
+        *z_buffer = tr->z_buffer;
+        return;
+    }
+
+    IRect rect = tile_raster_tile_rect(tr, tile);
+    uint8_t *block = tr->tile_blocks + (size_t)tile * tr->tile_block_size;
+    // pixel (x, y) of the tile is (y - rect.y) * tile_size + (x - rect.x) into either half of the block.
+    // a tile's block starts at least rect.y * tile_size + rect.x pixels of either kind in, so the origins stay inside the allocation
+    size_t origin = (size_t)rect.y * tr->tile_size + rect.x;
+    *color_view = *tr->pb;
+    color_view->stride = tr->tile_size;
+    color_view->pixels = (uint32_t *)block - origin;
+    *depth_view = *tr->z_buffer;
+    depth_view->stride = tr->tile_size;
+    depth_view->data = block + (size_t)tr->tile_size * tr->tile_size * sizeof(uint32_t) - origin * depth_format_size(depth_view->format);
+    *pb = color_view;
+    *z_buffer = depth_view;
+}
+
+// one row of a tile's z back to the cleared value
+static void clear_depth_row(const DepthBuffer *db, int y, IRect clip, bool stream)
+{
+    void *z_row = depth_buffer_row(db, y);
+    switch (db->format)
+    {
+    case DEPTH_FORMAT_U16:
+    {
+        // two pixels a word, tiles start on an even pixel
+        uint16_t *row = (uint16_t *)z_row + clip.x;
+        fill_row((uint32_t *)row, (DEPTH_U16_CLEARED << 16) | DEPTH_U16_CLEARED, clip.w / 2, stream);
+        if (clip.w & 1)
+            row[clip.w - 1] = DEPTH_U16_CLEARED;
+        break;
+    }
+    case DEPTH_FORMAT_U24:
+        fill_row((uint32_t *)z_row + clip.x, DEPTH_U24_CLEARED, clip.w, stream);
+        break;
+    default:
+    {
+        union
+        {
+            float f;
+            uint32_t u;
+        } cleared = {FLT_MAX};
+        fill_row((uint32_t *)z_row + clip.x, cleared.u, clip.w, stream);
+        break;
+    }
+    }
+}
+
+// one row of a tile's color back to the background
+static void clear_color_row(const TileRaster *tr, Texture *pb, int y, IRect clip, bool stream)
+{
+    uint32_t *row = pb->pixels + y * pb->stride + clip.x;
+    if (tr->background)
+        copy_row(row, tr->background->pixels + y * tr->background->stride + clip.x, clip.w, stream);
+    else
+        fill_row(row, 0, clip.w, stream);
+}
+
+// z (and hi-z) always, the color only when asked
+static void tile_raster_clear_tile(TileRaster *tr, int tile, Texture *pb, DepthBuffer *z_buffer, bool color, bool stream)
+{
+    IRect clip = tile_raster_tile_rect(tr, tile);
+    for (int y = clip.y; y < clip.y + clip.h; y++)
+    {
+        clear_depth_row(z_buffer, y, clip, stream);
+        if (color)
+            clear_color_row(tr, pb, y, clip, stream);
+    }
+    if (tr->hi_z)
+    {
+        hi_z_clear_rect(tr->hi_z, clip.x, clip.y, clip.x + clip.w - 1, clip.y + clip.h - 1);
+    }
+    tr->tile_generation[tile] = tr->generation;
+}
+
+// when every triangle in the tile writes z wherever it writes color, the pixels left at the cleared
+// depth are exactly the ones nothing got drawn on, so the color clear can wait until after drawing
+static bool tile_raster_bin_writes_z(const TileRaster *tr, const TileBin *bin)
+{
+    for (int i = 0; i < bin->length; i++)
+    {
+        const BinnedTriangle *bt = &tr->triangles[bin->triangles[i]];
+        // the visibility buffer writes z for everything, but its texels still blend by their own alpha
+        if (tr->id_buffer ? span_resolve_alpha(ALPHA_AUTO, bt->texture) == ALPHA_BLEND
+                          : bt->depth != DEPTH_WRITE || span_resolve_alpha(bt->alpha, bt->texture) == ALPHA_BLEND)
+            return false;
+    }
+    return true;
+}
+
+#if SIMD_X86
+// a bit for each of the 4 pixels from x on that still hold the cleared depth
+static inline int cleared_bits_sse2(const void *z_row, int x, DepthFormat format)
+{
+    if (format == DEPTH_FORMAT_U16)
+    {
+        __m128i equal = _mm_cmpeq_epi16(_mm_loadl_epi64((const __m128i *)((const uint16_t *)z_row + x)), _mm_set1_epi16((short)DEPTH_U16_CLEARED));
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(equal, equal)));
+    }
+    if (format == DEPTH_FORMAT_U24)
+    {
+        __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)((const uint32_t *)z_row + x)), _mm_set1_epi32(DEPTH_U24_CLEARED));
+        return _mm_movemask_ps(_mm_castsi128_ps(equal));
+    }
+    return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps((const float *)z_row + x), _mm_set1_ps(FLT_MAX)));
+}
+#endif
+
+// the deferred color clear, only touches pixels nothing was drawn on
+static void tile_raster_fill_uncovered(TileRaster *tr, Texture *pb, DepthBuffer *z_buffer, IRect clip)
+{
+    DepthFormat format = z_buffer->format;
+    for (int y = clip.y; y < clip.y + clip.h; y++)
+    {
+        // x counts from the tile's left edge, the z row is the whole row
+        const void *z_row = depth_buffer_row(z_buffer, y);
+        uint32_t *row = pb->pixels + y * pb->stride + clip.x;
+        const uint32_t *background = tr->background ? tr->background->pixels + y * tr->background->stride + clip.x : NULL;
+        int x = 0;
+#if SIMD_X86
+        // 4 at a time, runs that are all drawn on or all empty (most of them) skip the per pixel test
+        if (simd_level() >= SIMD_LEVEL_SSE2)
+        {
+            for (; x + 4 <= clip.w; x += 4)
+            {
+                int empty = cleared_bits_sse2(z_row, clip.x + x, format);
+                if (empty == 0xF)
+                {
+                    _mm_storeu_si128((__m128i *)(row + x), background ? _mm_loadu_si128((const __m128i *)(background + x)) : _mm_setzero_si128());
+                }
+                else if (empty)
+                {
+                    for (int k = 0; k < 4; k++)
+                        if (empty & (1 << k))
+                            row[x + k] = background ? background[x + k] : 0;
+                }
+            }
+        }
+#endif
+        for (; x < clip.w; x++)
+        {
+            if (depth_cleared(z_row, clip.x + x, format))
+                row[x] = background ? background[x] : 0;
+        }
+    }
+}
+
+void tile_raster_clear(TileRaster *tr, Texture *pb, DepthBuffer *z_buffer, HiZ *hi_z, const Texture *background)
+{
+    tr->pb = pb;
+    tr->z_buffer = z_buffer;
+    tr->hi_z = hi_z;
+    tr->background = background;
+    tr->generation++;
+    if (RASTER_TILED_FRAMEBUFFER)
+    {
+        tile_raster_alloc_blocks(tr, z_buffer->format);
+    }
+}
+
+// the end of the frame for one tile. straight into the targets only the tiles nothing was drawn on need
+// anything, they get cleared. with tile blocks every tile's color goes out to pb, and the tiles nothing was
+// drawn on get the background there without their block being touched
+static void tile_raster_finish_tile(TileRaster *tr, int tile)
+{
+    bool drawn = tr->tile_generation[tile] == tr->generation;
+    if (!tr->tile_blocks)
+    {
+        if (!drawn)
+            tile_raster_clear_tile(tr, tile, tr->pb, tr->z_buffer, true, CLEAR_STREAMING_STORES);
+        return;
+    }
+
+    IRect clip = tile_raster_tile_rect(tr, tile);
+    if (!drawn)
+    {
+        for (int y = clip.y; y < clip.y + clip.h; y++)
+            clear_color_row(tr, tr->pb, y, clip, CLEAR_STREAMING_STORES);
+        if (tr->hi_z)
+            hi_z_clear_rect(tr->hi_z, clip.x, clip.y, clip.x + clip.w - 1, clip.y + clip.h - 1);
+        return;
+    }
+    Texture color_view, *color;
+    DepthBuffer depth_view, *depth;
+    tile_raster_tile_targets(tr, tile, &color_view, &depth_view, &color, &depth);
+    for (int y = clip.y; y < clip.y + clip.h; y++)
+    {
+        copy_row(tr->pb->pixels + y * tr->pb->stride + clip.x, color->pixels + y * color->stride + clip.x, clip.w, CLEAR_STREAMING_STORES);
+    }
+}
+
+void tile_raster_resolve(TileRaster *tr)
+{
+    if (!tr->pb)
+        return;
+    tr->resolving = true;
+    tile_raster_run(tr);
+    tr->resolving = false;
+#if SIMD_X86
+    // streaming stores aren't ordered with the normal ones, make them land before anyone reads the buffers
+    _mm_sfence();
+#endif
+}
+
+void tile_raster_begin(TileRaster *tr, Texture *pb, DepthBuffer *z_buffer, HiZ *hi_z)
+{
+    tr->pb = pb;
+    tr->z_buffer = z_buffer;
+    tr->hi_z = hi_z;
+    tr->triangle_count = 0;
+    tr->shape_count = 0;
+    tr->face_count = 0;
+    for (int i = 0; i < tr->tiles_x * tr->tiles_y; i++)
+    {
+        tr->bins[i].length = 0;
+    }
+}
+
+static void tile_bin_push(TileBin *bin, uint32_t triangle)
+{
+    if (bin->length == bin->capacity)
+    {
+        int new_capacity = bin->capacity ? bin->capacity * 2 : 64;
+        uint32_t *grown = (uint32_t *)realloc(bin->triangles, sizeof(uint32_t) * new_capacity);
+        if (!grown)
+        {
+            fprintf(stderr, "Failed to grow tile bin.\n");
+            return;
+        }
+        bin->triangles = grown;
+        bin->capacity = new_capacity;
+    }
+    bin->triangles[bin->length++] = triangle;
+}
+
+static bool tile_raster_reserve_faces(TileRaster *tr, int face_count)
+{
+    if (tr->face_count + face_count <= tr->face_capacity)
+        return true;
+    int new_capacity = tr->face_capacity ? tr->face_capacity : 1024;
+    while (new_capacity < tr->face_count + face_count)
+        new_capacity *= 2;
+    uint32_t *grown = (uint32_t *)realloc(tr->face_triangles, sizeof(uint32_t) * new_capacity);
+    if (!grown)
+    {
+        fprintf(stderr, "Failed to grow face list.\n");
+        return false;
+    }
+    tr->face_triangles = grown;
+    tr->face_capacity = new_capacity;
+    return true;
+}
+
+void tile_raster_begin_shape(TileRaster *tr, int face_count)
+{
+    if (tr->shape_count == tr->shape_capacity)
+    {
+        int new_capacity = tr->shape_capacity ? tr->shape_capacity * 2 : 64;
+        int *first = (int *)realloc(tr->shape_first_face, sizeof(int) * new_capacity);
+        if (first)
+            tr->shape_first_face = first;
+        int *count = (int *)realloc(tr->shape_face_count, sizeof(int) * new_capacity);
+        if (count)
+            tr->shape_face_count = count;
+        if (!first || !count)
+        {
+            fprintf(stderr, "Failed to grow shape list.\n");
+            return;
+        }
+        tr->shape_capacity = new_capacity;
+    }
+    if (!tile_raster_reserve_faces(tr, face_count))
+        return;
+
+    tr->shape_first_face[tr->shape_count] = tr->face_count;
+    tr->shape_face_count[tr->shape_count] = face_count;
+    for (int i = 0; i < face_count; i++)
+    {
+        tr->face_triangles[tr->face_count + i] = UINT32_MAX;
+    }
+    tr->face_count += face_count;
+    tr->shape_count++;
+}
+
+void tile_raster_submit_textured(TileRaster *tr, Texture *texture, Triangle t, Triangle t_uv, float z, AlphaMode alpha, DepthMode depth, int face)
+{
+    if (!texture)
+        return;
+
+    // screen space bounding box, clamped to the screen
+    float min_x = fminf(fminf(t.p1.x, t.p2.x), t.p3.x);
+    float max_x = fmaxf(fmaxf(t.p1.x, t.p2.x), t.p3.x);
+    float min_y = fminf(fminf(t.p1.y, t.p2.y), t.p3.y);
+    float max_y = fmaxf(fmaxf(t.p1.y, t.p2.y), t.p3.y);
+    if (max_y - min_y == 0.0f)
+        return; // Degenerate triangle, the rasterizer would skip it too
+
+    int x0 = imax((int)floorf(min_x), 0);
+    int x1 = imin((int)ceilf(max_x), tr->width - 1);
+    int y0 = imax((int)floorf(min_y), 0);
+    int y1 = imin((int)ceilf(max_y), tr->height - 1);
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    if (tr->triangle_count == tr->triangle_capacity)
+    {
+        int new_capacity = tr->triangle_capacity ? tr->triangle_capacity * 2 : 1024;
+        BinnedTriangle *grown = (BinnedTriangle *)realloc(tr->triangles, sizeof(BinnedTriangle) * new_capacity);
+        if (!grown)
+        {
+            fprintf(stderr, "Failed to grow binned triangle list.\n");
+            return;
+        }
+        tr->triangles = grown;
+        tr->triangle_capacity = new_capacity;
+    }
+    uint32_t index = tr->triangle_count++;
+    int shape = tr->shape_count - 1;
+    if (shape >= 0 && face < tr->shape_face_count[shape])
+    {
+        uint32_t *slot = &tr->face_triangles[tr->shape_first_face[shape] + face];
+        // the face was clipped into a fan and this is a later piece of it. the pieces have their own uv
+        // planes, so it gets an id of its own past the shape's faces. the shape being submitted is always
+        // the last one, so its run of face_triangles can grow in place
+        if (*slot != UINT32_MAX && tr->shape_face_count[shape] < (int)VIS_FACE_MASK && tile_raster_reserve_faces(tr, 1))
+        {
+            face = tr->shape_face_count[shape]++;
+            slot = &tr->face_triangles[tr->face_count++];
+        }
+        *slot = index;
+    }
+    tr->triangles[index] = (BinnedTriangle){texture, t, t_uv, z, alpha, depth, VIS_ID(shape, face)};
+
+    int tile_x0 = x0 / tr->tile_size;
+    int tile_x1 = x1 / tr->tile_size;
+    int tile_y0 = y0 / tr->tile_size;
+    int tile_y1 = y1 / tr->tile_size;
+    for (int ty = tile_y0; ty <= tile_y1; ty++)
+    {
+        for (int tx = tile_x0; tx <= tile_x1; tx++)
+        {
+            tile_bin_push(&tr->bins[ty * tr->tiles_x + tx], index);
+        }
+    }
+}
+
+static const BinnedTriangle *tile_raster_lookup(TileRaster *tr, uint32_t id)
+{
+    int shape = id >> VIS_FACE_BITS;
+    int face = id & VIS_FACE_MASK;
+    if (shape >= tr->shape_count || face >= tr->shape_face_count[shape])
+        return NULL;
+    uint32_t index = tr->face_triangles[tr->shape_first_face[shape] + face];
+    return index == UINT32_MAX ? NULL : &tr->triangles[index];
+}
+
+// phase two of the visibility buffer, every covered pixel gets textured exactly once
+static void tile_raster_resolve_tile(TileRaster *tr, Texture *pb, IRect clip)
+{
+    Texture *ids = tr->id_buffer;
+    uint32_t last_id = VIS_EMPTY;
+    const BinnedTriangle *bt = NULL;
+    const Texture *level = NULL;
+    UVSetup uvs;
+    int x_end = clip.x + clip.w;
+    for (int y = clip.y; y < clip.y + clip.h; y++)
+    {
+        const uint32_t *id_row = ids->pixels + y * ids->stride;
+        int x = clip.x;
+        while (x < x_end)
+        {
+            // shade runs of the same id in one go
+            uint32_t id = id_row[x];
+            int run_end = x + 1;
+            while (run_end < x_end && id_row[run_end] == id)
+                run_end++;
+
+            if (id != VIS_EMPTY)
+            {
+                // neighbouring runs are mostly the same triangle, only redo the uv setup when it changes
+                if (id != last_id)
+                {
+                    last_id = id;
+                    bt = tile_raster_lookup(tr, id);
+                    if (bt)
+                    {
+                        raster_uv_setup(&uvs, bt->t, bt->t_uv);
+                        level = raster_uv_mip(bt->texture, &uvs);
+                    }
+                }
+                if (bt)
+                    raster_uv_span(pb, level, &uvs, y, x, run_end - 1);
+            }
+            x = run_end;
+        }
+    }
+}
+
+static void tile_raster_draw_tile(TileRaster *tr, int tile)
+{
+    TileBin *bin = &tr->bins[tile];
+    IRect clip = tile_raster_tile_rect(tr, tile);
+    Texture color_view, *pb;
+    DepthBuffer depth_view, *z_buffer;
+    tile_raster_tile_targets(tr, tile, &color_view, &depth_view, &pb, &z_buffer);
+
+    // first time the tile gets drawn this frame, it still holds the last one
+    bool fill_uncovered = false;
+    if (tr->tile_generation[tile] != tr->generation)
+    {
+        fill_uncovered = tile_raster_bin_writes_z(tr, bin);
+        tile_raster_clear_tile(tr, tile, pb, z_buffer, !fill_uncovered, false);
+    }
+
+    if (tr->id_buffer)
+    {
+        for (int y = clip.y; y < clip.y + clip.h; y++)
+        {
+            uint32_t *id_row = tr->id_buffer->pixels + y * tr->id_buffer->stride;
+            for (int x = clip.x; x < clip.x + clip.w; x++)
+            {
+                id_row[x] = VIS_EMPTY;
+            }
+        }
+    }
+
+    // hi-z counts stay with the thread until the tile is done, and aren't kept at all without SHOW_HI_Z_STATS
+    HiZCounts counts = {0};
+    HiZCounts *tile_counts = SHOW_HI_Z_STATS && tr->hi_z ? &counts : NULL;
+    for (int i = 0; i < bin->length; i++)
+    {
+        BinnedTriangle *bt = &tr->triangles[bin->triangles[i]];
+        // everything in this tile is already closer than the triangle
+        if (tr->hi_z && hi_z_coarse_occluded(tr->hi_z, clip.x, clip.y, clip.x + clip.w - 1, clip.y + clip.h - 1, depth_buffer_encode(z_buffer, bt->z)))
+        {
+            counts.tiles_rejected++;
+            continue;
+        }
+        if (tr->id_buffer)
+        {
+            raster_halfspace_ids(tr->id_buffer, z_buffer, tr->hi_z, tile_counts, bt->t, bt->id, bt->z, clip);
+        }
+        else if (RASTER_HALFSPACE_TEXTURED && raster_halfspace_handles(bt->texture, bt->alpha, bt->depth))
+        {
+            raster_halfspace_textured(pb, bt->texture, z_buffer, tr->hi_z, tile_counts, bt->t, bt->t_uv, bt->z, clip);
+        }
+        else
+        {
+            draw_triangle_scanline_with_texture_clipped(pb, bt->texture, z_buffer, bt->t, bt->t_uv, bt->z, bt->alpha, bt->depth, clip);
+        }
+    }
+
+    if (tile_counts)
+    {
+        hi_z_add_stats(tr->hi_z, tile_counts);
+    }
+
+    if (tr->id_buffer)
+    {
+        tile_raster_resolve_tile(tr, pb, clip);
+    }
+    if (fill_uncovered)
+    {
+        tile_raster_fill_uncovered(tr, pb, z_buffer, clip);
+    }
+}
+
+// pulls tiles off the shared counter until there are none left
+static void tile_raster_run_tiles(TileRaster *tr)
+{
+    int tile_count = tr->tiles_x * tr->tiles_y;
+    while (true)
+    {
+        int tile = SDL_AtomicAdd(&tr->next_tile, 1);
+        if (tile >= tile_count)
+        {
+            break;
+        }
+        if (tr->resolving)
+        {
+            tile_raster_finish_tile(tr, tile);
+        }
+        else if (tr->bins[tile].length > 0)
+        {
+            tile_raster_draw_tile(tr, tile);
+        }
+    }
+}
+
+// every thread through tile_raster_run_tiles once, returns when they're all done
+static void tile_raster_run(TileRaster *tr)
+{
+    SDL_AtomicSet(&tr->next_tile, 0);
+    for (int i = 0; i < tr->num_threads - 1; i++)
+    {
+        SDL_SemPost(tr->start_sem);
+    }
+    tile_raster_run_tiles(tr);
+    for (int i = 0; i < tr->num_threads - 1; i++)
+    {
+        SDL_SemWait(tr->done_sem);
+    }
+}
+
+void tile_raster_flush(TileRaster *tr)
+{
+    if (tr->triangle_count > 0)
+    {
+        tile_raster_run(tr);
+    }
+
+    tr->triangle_count = 0;
+    tr->shape_count = 0;
+    tr->face_count = 0;
+    for (int i = 0; i < tr->tiles_x * tr->tiles_y; i++)
+    {
+        tr->bins[i].length = 0;
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef TILE_RASTER_H
+#define TILE_RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "primitives.h"
+#include "texture.h"
+#include "depth_buffer.h"
+#include "hi_z.h"
+#include "material.h"
+
+/*
+    Tile binned rasterizer.
+    Triangles are set up once and binned into fixed size screen tiles,
+    then worker threads each grab whole tiles and rasterize them.
+    Every pixel belongs to exactly one tile, so there are no locks on the color or z buffer,
+    and each tile draws its triangles in submission order so the output matches drawing
+    the same triangles one after another on one thread.
+
+    With RASTER_VISIBILITY_BUFFER each tile is drawn in two phases instead: first only depth and a
+    packed (shape, face) id go into id_buffer, then every covered pixel of the tile is textured once
+    from the triangle its id points at, so overdrawn pixels never pay for a texture fetch.
+
+    Clears are lazy. tile_raster_clear only moves the frame generation on, a tile whose tag is
+    behind it still holds the last frame and gets cleared when it's first drawn. When none of a
+    tile's triangles blend or skip the z write, its color isn't cleared up front at all: after
+    drawing, only the pixels still at the cleared depth get the background, so a fully covered tile
+    never writes its clear color. Tiles nothing lands on get cleared by tile_raster_resolve.
+
+    With RASTER_TILED_FRAMEBUFFER the tiles don't draw into the targets at all. Each tile has a block
+    of its own holding its color and then its depth, tile_size pixels a row, so everything a tile
+    touches while it's drawn sits together instead of being spread over rows a whole screen apart.
+    tile_raster_resolve then copies every tile's color out to pb as linear rows. The z buffer given
+    to tile_raster_clear only sets the depth format then, the depths stay in the blocks.
+*/
+
+// packed visibility buffer ids: shape in the top 12 bits, face in the low 20
+#define VIS_FACE_BITS 20
+#define VIS_FACE_MASK ((1u << VIS_FACE_BITS) - 1)
+#define VIS_ID(shape, face) (((uint32_t)(shape) << VIS_FACE_BITS) | ((uint32_t)(face) & VIS_FACE_MASK))
+#define VIS_EMPTY 0xFFFFFFFFu
+
+typedef struct
+{
+    Texture *texture;
+    Triangle t;
+    Triangle t_uv;
+    float z;
+    AlphaMode alpha;
+    DepthMode depth;
+    uint32_t id; // VIS_ID(shape, face)
+} BinnedTriangle;
+
+// list of triangle indices (into TileRaster->triangles) overlapping one tile
+typedef struct
+{
+    int length;
+    int capacity;
+    uint32_t *triangles;
+} TileBin;
+
+typedef struct
+{
+    int width;
+    int height;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    TileBin *bins; // tiles_x * tiles_y
+
+    // every triangle submitted since the last flush
+    BinnedTriangle *triangles;
+    int triangle_count;
+    int triangle_capacity;
+
+    // visibility buffer mode, id_buffer is NULL when it's off
+    Texture *id_buffer;
+    // shapes are numbered in tile_raster_begin_shape order, each gets a run of face_triangles
+    int shape_count;
+    int shape_capacity;
+    int *shape_first_face;
+    int *shape_face_count;
+    // binned triangle index of every (shape, face), UINT32_MAX for faces that weren't submitted
+    uint32_t *face_triangles;
+    int face_count;
+    int face_capacity;
+
+    // targets of the current frame
+    Texture *pb;
+    DepthBuffer *z_buffer;
+    HiZ *hi_z; // optional
+    const Texture *background; // what pb clears to, same size. NULL clears to 0
+
+    // a tile is cleared for this frame once its tag matches generation
+    uint32_t generation;
+    uint32_t *tile_generation; // tiles_x * tiles_y
+
+    // RASTER_TILED_FRAMEBUFFER: tiles_x * tiles_y blocks of tile_block_size bytes, tile_size * tile_size
+    // colors followed by as many depths of tile_block_format. NULL when the tiles draw into the targets
+    uint8_t *tile_blocks;
+    size_t tile_block_size;
+    DepthFormat tile_block_format;
+    bool resolving; // the threads are running tile_raster_resolve instead of drawing
+
+    // worker threads, the calling thread also works during a flush so there are num_threads - 1 of these
+    int num_threads;
+    SDL_Thread **threads;
+    SDL_sem *start_sem;
+    SDL_sem *done_sem;
+    SDL_atomic_t next_tile;
+    bool quit;
+} TileRaster;
+
+// num_threads <= 0 uses one thread per cpu core
+TileRaster *tile_raster_new(int width, int height, int tile_size, int num_threads);
+void tile_raster_free(TileRaster *tr);
+
+// starts a frame: every tile of the targets counts as cleared from here on, without anything being written yet.
+// replaces texture_clear, depth_buffer_clear and hi_z_clear on the targets
+void tile_raster_clear(TileRaster *tr, Texture *pb, DepthBuffer *z_buffer, HiZ *hi_z, const Texture *background);
+// ends the frame on every thread: clears the tiles nothing was drawn into, and with tile blocks copies the
+// rest out to pb. call it once all the drawing is flushed, before anything else reads or draws over the targets
+void tile_raster_resolve(TileRaster *tr);
+
+// the targets have to be the ones given to tile_raster_clear
+void tile_raster_begin(TileRaster *tr, Texture *pb, DepthBuffer *z_buffer, HiZ *hi_z);
+// starts a new shape, the faces submitted after this are its faces 0..face_count-1. later pieces of a
+// clipped face are numbered on from face_count
+void tile_raster_begin_shape(TileRaster *tr, int face_count);
+// alpha and depth are ignored in visibility buffer mode, everything is drawn as opaque depth writes there
+void tile_raster_submit_textured(TileRaster *tr, Texture *texture, Triangle t, Triangle t_uv, float z, AlphaMode alpha, DepthMode depth, int face);
+// rasterizes everything binned since tile_raster_begin and waits for the workers to finish
+void tile_raster_flush(TileRaster *tr);
+
+#endif // TILE_RASTER_H
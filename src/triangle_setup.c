@@ -0,0 +1,208 @@
+#include "triangle_setup.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "clip.h"
+
+typedef enum
+{
+    SETUP_KEEP,
+    SETUP_OUTSIDE,
+    SETUP_BACKFACE,
+    SETUP_DEGENERATE,
+} SetupResult;
+
+// snaps like edge_setup in the rasterizer, so a zero area here is exactly a triangle it would skip.
+// with the vertices on the pixel grid any other triangle covers at least its own corner pixels
+static SetupResult classify(Triangle t, CullMode cull_mode)
+{
+    IVec2 p0 = vec2_to_ivec2(t.p1);
+    IVec2 p1 = vec2_to_ivec2(t.p2);
+    IVec2 p2 = vec2_to_ivec2(t.p3);
+    int64_t area = (int64_t)(p1.x - p0.x) * (p2.y - p0.y) - (int64_t)(p1.y - p0.y) * (p2.x - p0.x);
+    if (area == 0)
+        return SETUP_DEGENERATE;
+
+    // obj front faces are counter clockwise, with y pointing down on screen that's a positive area here
+    bool front = area > 0;
+    if ((cull_mode == CULL_BACK && !front) || (cull_mode == CULL_FRONT && front))
+        return SETUP_BACKFACE;
+    return SETUP_KEEP;
+}
+
+// flat depth for all the pieces of a clipped triangle, so they z test as one face
+static float clipped_depth(const ClipVertex *poly, int count)
+{
+    float z = 0.0f;
+    for (int k = 0; k < count; k++)
+    {
+        z += poly[k].z;
+    }
+    return count ? z / (float)count : 0.0f;
+}
+
+// welded models have no texcoord_indices, their texcoords line up with the vertices
+static Vec2 face_uv(const SFA *texcoords, const SU32A *texcoord_indices, const SU32A *indices, int corner)
+{
+    if (!texcoords)
+        return (Vec2){0.0f, 0.0f};
+    int idx = texcoord_indices ? texcoord_indices->data[corner] : indices->data[corner];
+    return (Vec2){texcoords->data[idx * 2], texcoords->data[idx * 2 + 1]};
+}
+
+// crossing the near plane or way off screen, clip it and fan out what's left
+static SetupResult setup_clipped(
+    SetupList *out,
+    const VertexCache *vertex_cache,
+    const int idx[3],
+    const Vec2 uv[3],
+    bool guard_band,
+    CullMode cull_mode,
+    int face)
+{
+    ClipVertex in[3];
+    for (int k = 0; k < 3; k++)
+    {
+        in[k] = vertex_cache_clip_vertex(vertex_cache, idx[k]);
+        in[k].u = uv[k].x;
+        in[k].v = uv[k].y;
+    }
+    ClipVertex poly[CLIP_MAX_VERTS];
+    int count = clip_triangle(in, poly, guard_band);
+    if (count < 3)
+        return SETUP_OUTSIDE;
+
+    float z = clipped_depth(poly, count);
+    int width = vertex_cache->screen_width;
+    int height = vertex_cache->screen_height;
+    Vec2 first = clip_to_screen(&poly[0], width, height);
+    SetupResult result = SETUP_DEGENERATE;
+    for (int k = 1; k + 1 < count; k++)
+    {
+        Triangle t = {first, clip_to_screen(&poly[k], width, height), clip_to_screen(&poly[k + 1], width, height)};
+        SetupResult piece = classify(t, cull_mode);
+        if (piece != SETUP_KEEP)
+        {
+            if (result == SETUP_DEGENERATE)
+                result = piece;
+            continue;
+        }
+        result = SETUP_KEEP;
+        out->triangles[out->count++] = (SetupTriangle){
+            t,
+            {{poly[0].u, poly[0].v}, {poly[k].u, poly[k].v}, {poly[k + 1].u, poly[k + 1].v}},
+            z,
+            face,
+        };
+    }
+    return result;
+}
+
+bool triangle_setup(
+    SetupList *out,
+    Arena *arena,
+    const VertexCache *vertex_cache,
+    const SU32A *indices,
+    int first_face,
+    int end_face,
+    const SFA *texcoords,
+    const SU32A *texcoord_indices,
+    CullMode cull_mode,
+    SetupStats *stats)
+{
+    const float *screen = vertex_cache->screen->data;
+    const uint8_t *outcodes = vertex_cache->outcodes;
+    int num_faces = end_face - first_face;
+
+    // clipped faces can turn into several triangles, count them first to size the list
+    int clipped = 0;
+    for (int face = first_face; face < end_face; face++)
+    {
+        const uint32_t *tri = indices->data + face * 3;
+        if ((outcodes[tri[0]] | outcodes[tri[1]] | outcodes[tri[2]]) & (CLIP_NEAR | CLIP_GUARD))
+            clipped++;
+    }
+
+    out->count = 0;
+    out->triangles = (SetupTriangle *)arena_alloc(arena, sizeof(SetupTriangle) * (num_faces + clipped * (CLIP_MAX_VERTS - 3)));
+    if (!out->triangles)
+    {
+        fprintf(stderr, "Failed to allocate setup triangles.\n");
+        return false;
+    }
+
+    SetupStats counts = {0};
+    counts.submitted = num_faces;
+    for (int face = first_face; face < end_face; face++)
+    {
+        int idx[3] = {indices->data[face * 3], indices->data[face * 3 + 1], indices->data[face * 3 + 2]};
+        uint8_t c0 = outcodes[idx[0]], c1 = outcodes[idx[1]], c2 = outcodes[idx[2]];
+
+        // all the verts outside the same clip plane, this also catches triangles behind the camera
+        if (c0 & c1 & c2 & CLIP_OUTSIDE)
+        {
+            counts.culled_outside++;
+            continue;
+        }
+
+        Vec2 uv[3] = {
+            face_uv(texcoords, texcoord_indices, indices, face * 3),
+            face_uv(texcoords, texcoord_indices, indices, face * 3 + 1),
+            face_uv(texcoords, texcoord_indices, indices, face * 3 + 2)};
+
+        SetupResult result;
+        if ((c0 | c1 | c2) & (CLIP_NEAR | CLIP_GUARD))
+        {
+            result = setup_clipped(out, vertex_cache, idx, uv, (c0 | c1 | c2) & CLIP_GUARD, cull_mode, face);
+        }
+        else
+        {
+            Triangle t = {
+                {screen[idx[0] * 3], screen[idx[0] * 3 + 1]},
+                {screen[idx[1] * 3], screen[idx[1] * 3 + 1]},
+                {screen[idx[2] * 3], screen[idx[2] * 3 + 1]}};
+            result = classify(t, cull_mode);
+            if (result == SETUP_KEEP)
+            {
+                // average the z values of the 3 vertices
+                float z = (screen[idx[0] * 3 + 2] + screen[idx[1] * 3 + 2] + screen[idx[2] * 3 + 2]) / 3.0f;
+                out->triangles[out->count++] = (SetupTriangle){t, {uv[0], uv[1], uv[2]}, z, face};
+            }
+        }
+
+        if (result == SETUP_KEEP)
+            counts.rasterized++;
+        else if (result == SETUP_OUTSIDE)
+            counts.culled_outside++;
+        else if (result == SETUP_BACKFACE)
+            counts.culled_backface++;
+        else
+            counts.culled_degenerate++;
+    }
+
+    if (stats)
+    {
+        stats->submitted += counts.submitted;
+        stats->culled_outside += counts.culled_outside;
+        stats->culled_backface += counts.culled_backface;
+        stats->culled_degenerate += counts.culled_degenerate;
+        stats->rasterized += counts.rasterized;
+    }
+    return true;
+}
+
+void triangle_setup_print_stats(const SetupStats *stats)
+{
+    printf("setup: %d submitted, %d outside, %d backface, %d degenerate, %d rasterized\n",
+           stats->submitted,
+           stats->culled_outside,
+           stats->culled_backface,
+           stats->culled_degenerate,
+           stats->rasterized);
+}
+
+void triangle_setup_reset_stats(SetupStats *stats)
+{
+    *stats = (SetupStats){0};
+}
@@ -0,0 +1,64 @@
+#ifndef TRIANGLE_SETUP_H
+#define TRIANGLE_SETUP_H
+
+#include <stdbool.h>
+
+#include "primitives.h"
+#include "sfa.h"
+#include "su32a.h"
+#include "arena.h"
+#include "material.h"
+#include "vertex_cache.h"
+
+/*
+    Triangle setup, between the vertex cache and the rasterizer.
+    Walks a shape's faces, throws away everything that can't put a pixel on screen
+    (outside a clip plane, back facing for the material's cull mode, zero area once snapped
+    to the pixel grid the rasterizer uses) and clips the ones crossing the near plane.
+    The survivors come out as a dense list in the frame arena, ready to submit.
+*/
+
+typedef struct
+{
+    Triangle t;     // screen space
+    Triangle t_uv;  // zero when the mesh has no texcoords
+    float z;        // flat depth for the whole face
+    int face;       // index into the shape's faces, clipped pieces share it
+} SetupTriangle;
+
+typedef struct
+{
+    SetupTriangle *triangles;
+    int count;
+} SetupList;
+
+// counts for one frame, everything submitted ends up in exactly one of the other buckets.
+// a clipped face counts once, as rasterized if any of its pieces survive
+typedef struct
+{
+    int submitted;
+    int culled_outside;    // outside a clip plane, or nothing left after clipping
+    int culled_backface;   // wrong winding for the material's cull mode
+    int culled_degenerate; // zero area, or covers no pixel center
+    int rasterized;
+} SetupStats;
+
+// faces [first_face, end_face) of indices, the face numbers that come out stay relative to the whole of indices.
+// texcoords and texcoord_indices can be NULL, without texcoord_indices the texcoords get indexed by indices.
+// stats can be NULL
+bool triangle_setup(
+    SetupList *out,
+    Arena *arena,
+    const VertexCache *vertex_cache,
+    const SU32A *indices,
+    int first_face,
+    int end_face,
+    const SFA *texcoords,
+    const SU32A *texcoord_indices,
+    CullMode cull_mode,
+    SetupStats *stats);
+
+void triangle_setup_print_stats(const SetupStats *stats);
+void triangle_setup_reset_stats(SetupStats *stats);
+
+#endif // TRIANGLE_SETUP_H
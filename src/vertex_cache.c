@@ -0,0 +1,79 @@
+#include "vertex_cache.h"
+
+#include <stdio.h>
+
+bool vertex_cache_begin(
+    VertexCache *cache,
+    Arena *arena,
+    const VertexStream *positions,
+    const Mat4 *model,
+    const Mat4 *vp,
+    int screen_width,
+    int screen_height)
+{
+    Mat4 mvp = mat4_multiply(*vp, *model);
+    cache->positions = positions;
+    cache->mvp = mvp;
+    cache->screen_width = screen_width;
+    cache->screen_height = screen_height;
+
+    int count = positions->count;
+    cache->screen = sfa_new_in(arena, count * 3);
+    cache->inv_w = (float *)arena_alloc(arena, sizeof(float) * positions->capacity);
+    cache->outcodes = (uint8_t *)arena_alloc(arena, positions->capacity);
+    if (!cache->screen || !cache->inv_w || !cache->outcodes)
+    {
+        fprintf(stderr, "Failed to allocate vertex cache.\n");
+        return false;
+    }
+    return true;
+}
+
+int vertex_cache_project(VertexCache *cache, int first, int end)
+{
+    const VertexStream *p = cache->positions;
+    first = first / VERTEX_STREAM_PAD * VERTEX_STREAM_PAD;
+    end = (end + VERTEX_STREAM_PAD - 1) / VERTEX_STREAM_PAD * VERTEX_STREAM_PAD;
+    if (end > p->capacity)
+        end = p->capacity;
+    if (first >= end)
+        return 0;
+
+    // a window into the stream, first is a multiple of the pad so the arrays keep their alignment
+    VertexStream range = {
+        .count = (end < p->count ? end : p->count) - first,
+        .capacity = end - first,
+        .x = p->x + first,
+        .y = p->y + first,
+        .z = p->z + first,
+        .w = p->w + first};
+    if (range.count < 0)
+        range.count = 0;
+    // clip space vertices are never written out, the fused kernel goes straight to the screen
+    vertex_stream_project(
+        &range, &cache->mvp, cache->screen_width, cache->screen_height,
+        cache->screen->data + first * 3, cache->inv_w + first, cache->outcodes + first);
+    return range.capacity;
+}
+
+bool vertex_cache_build(
+    VertexCache *cache,
+    Arena *arena,
+    const VertexStream *positions,
+    const Mat4 *model,
+    const Mat4 *vp,
+    int screen_width,
+    int screen_height)
+{
+    if (!vertex_cache_begin(cache, arena, positions, model, vp, screen_width, screen_height))
+        return false;
+    vertex_cache_project(cache, 0, positions->count);
+    return true;
+}
+
+ClipVertex vertex_cache_clip_vertex(const VertexCache *cache, int index)
+{
+    const VertexStream *p = cache->positions;
+    Vec4 clip = mat4_multiply_vec4(cache->mvp, (Vec4){p->x[index], p->y[index], p->z[index], p->w[index]});
+    return (ClipVertex){clip.x, clip.y, clip.z, clip.w, 0.0f, 0.0f};
+}
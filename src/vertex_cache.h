@@ -0,0 +1,59 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sfa.h"
+#include "mat4.h"
+#include "arena.h"
+#include "vertex_stream.h"
+#include "clip.h"
+
+/*
+    Post transform vertices of one model for the current frame.
+    Every shape of a model indexes into the same vertex pool, so the pool is transformed
+    and mapped to the screen once here and all the shapes rasterize against the result.
+    Shapes that get culled whole can leave their part of the pool untouched, only the
+    vertex ranges that are projected hold anything. The arrays live in the frame arena.
+*/
+typedef struct
+{
+    SFA *screen;       // x y depth
+    float *inv_w;      // 1 / clip w
+    uint8_t *outcodes; // CLIP_* bits, a triangle with all three sharing a CLIP_OUTSIDE bit is off screen
+
+    // kept so triangles that need clipping can get their clip space vertices back
+    const VertexStream *positions;
+    Mat4 mvp;
+    int screen_width;
+    int screen_height;
+} VertexCache;
+
+// allocates the arrays but projects nothing yet, vertex_cache_project fills in the ranges that get drawn
+bool vertex_cache_begin(
+    VertexCache *cache,
+    Arena *arena,
+    const VertexStream *positions,
+    const Mat4 *model,
+    const Mat4 *vp,
+    int screen_width,
+    int screen_height);
+// projects vertices [first, end), widened to VERTEX_STREAM_PAD boundaries so the kernels stay aligned.
+// returns how many vertices went through the transform
+int vertex_cache_project(VertexCache *cache, int first, int end);
+
+// begin + project the whole pool
+bool vertex_cache_build(
+    VertexCache *cache,
+    Arena *arena,
+    const VertexStream *positions,
+    const Mat4 *model,
+    const Mat4 *vp,
+    int screen_width,
+    int screen_height);
+
+// clip space position of one vertex, uv left at 0
+ClipVertex vertex_cache_clip_vertex(const VertexCache *cache, int index);
+
+#endif // VERTEX_CACHE_H
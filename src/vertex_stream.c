@@ -0,0 +1,473 @@
+#include "vertex_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+
+static int pad_count(int count)
+{
+    return (count + VERTEX_STREAM_PAD - 1) & ~(VERTEX_STREAM_PAD - 1);
+}
+
+VertexStream *vertex_stream_new_in(Arena *arena, int count)
+{
+    int capacity = pad_count(count);
+    size_t bytes = sizeof(float) * 4 * (size_t)capacity;
+
+    VertexStream *vs;
+    float *data;
+    if (arena)
+    {
+        vs = (VertexStream *)arena_alloc(arena, sizeof(VertexStream));
+        data = vs ? (float *)arena_alloc(arena, bytes) : NULL;
+    }
+    else
+    {
+        vs = (VertexStream *)malloc(sizeof(VertexStream));
+        data = vs ? (float *)simd_alloc(ARENA_ALIGN, bytes) : NULL;
+        if (vs && !data)
+            free(vs);
+    }
+    if (!vs || !data)
+    {
+        fprintf(stderr, "Failed to allocate vertex stream of %d vertices.\n", count);
+        return NULL;
+    }
+
+    vs->count = count;
+    vs->capacity = capacity;
+    vs->x = data;
+    vs->y = data + capacity;
+    vs->z = data + capacity * 2;
+    vs->w = data + capacity * 3;
+    // only the padding needs clearing, the real vertices get written by the caller
+    size_t pad_bytes = sizeof(float) * (size_t)(capacity - count);
+    if (pad_bytes)
+    {
+        memset(vs->x + count, 0, pad_bytes);
+        memset(vs->y + count, 0, pad_bytes);
+        memset(vs->z + count, 0, pad_bytes);
+        memset(vs->w + count, 0, pad_bytes);
+    }
+    return vs;
+}
+
+void vertex_stream_free(VertexStream *vs)
+{
+    if (!vs)
+        return;
+    simd_free(vs->x);
+    free(vs);
+}
+
+VertexStream *vertex_stream_from_sfa_in(Arena *arena, const SFA *xyz)
+{
+    if (!xyz)
+        return NULL;
+
+    int count = xyz->length / 3;
+    VertexStream *vs = vertex_stream_new_in(arena, count);
+    if (!vs)
+        return NULL;
+    for (int i = 0; i < count; i++)
+    {
+        vs->x[i] = xyz->data[i * 3 + 0];
+        vs->y[i] = xyz->data[i * 3 + 1];
+        vs->z[i] = xyz->data[i * 3 + 2];
+        vs->w[i] = 1.0f;
+    }
+    return vs;
+}
+
+//////////////////////// KERNELS ////////////////////////
+// each one does rows of the matrix against whole registers of vertices,
+// ((m0 * x + m1 * y) + m2 * z) + m3 * w like mat4_multiply_vec4, no fma so the results match
+
+static void transform_scalar(const VertexStream *in, VertexStream *out, const Mat4 *m)
+{
+    for (int i = 0; i < in->capacity; i++)
+    {
+        float x = in->x[i];
+        float y = in->y[i];
+        float z = in->z[i];
+        float w = in->w[i];
+        out->x[i] = m->m[0][0] * x + m->m[0][1] * y + m->m[0][2] * z + m->m[0][3] * w;
+        out->y[i] = m->m[1][0] * x + m->m[1][1] * y + m->m[1][2] * z + m->m[1][3] * w;
+        out->z[i] = m->m[2][0] * x + m->m[2][1] * y + m->m[2][2] * z + m->m[2][3] * w;
+        out->w[i] = m->m[3][0] * x + m->m[3][1] * y + m->m[3][2] * z + m->m[3][3] * w;
+    }
+}
+
+static inline uint8_t clip_outcode(float x, float y, float z, float w)
+{
+    uint8_t code = 0;
+    if (x < -w)
+        code |= CLIP_LEFT;
+    if (x > w)
+        code |= CLIP_RIGHT;
+    if (y < -w)
+        code |= CLIP_BOTTOM;
+    if (y > w)
+        code |= CLIP_TOP;
+    if (z < -w)
+        code |= CLIP_NEAR;
+    float guard = CLIP_GUARD_BAND * w;
+    if (x < -guard || x > guard || y < -guard || y > guard)
+        code |= CLIP_GUARD;
+    return code;
+}
+
+// the divide leaves x y alone when w is 0, same as perspective_divide
+static void project_scalar(const VertexStream *in, const Mat4 *m, float width, float height, float *screen, float *inv_w, uint8_t *outcodes)
+{
+    for (int i = 0; i < in->capacity; i++)
+    {
+        float x = in->x[i];
+        float y = in->y[i];
+        float z = in->z[i];
+        float w = in->w[i];
+        float cx = m->m[0][0] * x + m->m[0][1] * y + m->m[0][2] * z + m->m[0][3] * w;
+        float cy = m->m[1][0] * x + m->m[1][1] * y + m->m[1][2] * z + m->m[1][3] * w;
+        float cz = m->m[2][0] * x + m->m[2][1] * y + m->m[2][2] * z + m->m[2][3] * w;
+        float cw = m->m[3][0] * x + m->m[3][1] * y + m->m[3][2] * z + m->m[3][3] * w;
+
+        outcodes[i] = clip_outcode(cx, cy, cz, cw);
+        inv_w[i] = cw != 0.0f ? 1.0f / cw : 0.0f;
+        if (i >= in->count)
+            continue;
+        if (cw != 0.0f)
+        {
+            cx /= cw;
+            cy /= cw;
+        }
+        screen[i * 3 + 0] = (cx * 0.5f + 0.5f) * width;
+        screen[i * 3 + 1] = (1.0f - (cy * 0.5f + 0.5f)) * height; // Y-axis inverted
+        screen[i * 3 + 2] = cz;
+    }
+}
+
+// the simd kernels keep the lanes in registers up to here, then write the interleaved x y depth
+// the rasterizer reads and the outcodes from the plane compare masks
+static inline void store_lanes(
+    int lanes, int i, int count,
+    const float *sx, const float *sy, const float *sz,
+    const unsigned *masks, // left right bottom top near guard, one bit per lane
+    float *screen, uint8_t *outcodes)
+{
+    for (int l = 0; l < lanes; l++)
+    {
+        outcodes[i + l] = (uint8_t)((((masks[0] >> l) & 1) * CLIP_LEFT) |
+                                    (((masks[1] >> l) & 1) * CLIP_RIGHT) |
+                                    (((masks[2] >> l) & 1) * CLIP_BOTTOM) |
+                                    (((masks[3] >> l) & 1) * CLIP_TOP) |
+                                    (((masks[4] >> l) & 1) * CLIP_NEAR) |
+                                    (((masks[5] >> l) & 1) * CLIP_GUARD));
+    }
+    int n = count - i < lanes ? count - i : lanes;
+    for (int l = 0; l < n; l++)
+    {
+        screen[(i + l) * 3 + 0] = sx[l];
+        screen[(i + l) * 3 + 1] = sy[l];
+        screen[(i + l) * 3 + 2] = sz[l];
+    }
+}
+
+#if SIMD_X86
+
+static void transform_sse2(const VertexStream *in, VertexStream *out, const Mat4 *m)
+{
+    __m128 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm_set1_ps(m->m[r][k]);
+
+    for (int i = 0; i < in->capacity; i += 4)
+    {
+        __m128 x = _mm_load_ps(in->x + i);
+        __m128 y = _mm_load_ps(in->y + i);
+        __m128 z = _mm_load_ps(in->z + i);
+        __m128 w = _mm_load_ps(in->w + i);
+        float *dst[4] = {out->x + i, out->y + i, out->z + i, out->w + i};
+        for (int r = 0; r < 4; r++)
+        {
+            __m128 v = _mm_add_ps(_mm_mul_ps(c[r][0], x), _mm_mul_ps(c[r][1], y));
+            v = _mm_add_ps(v, _mm_mul_ps(c[r][2], z));
+            v = _mm_add_ps(v, _mm_mul_ps(c[r][3], w));
+            _mm_store_ps(dst[r], v);
+        }
+    }
+}
+
+SIMD_TARGET_AVX2
+static void transform_avx2(const VertexStream *in, VertexStream *out, const Mat4 *m)
+{
+    __m256 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm256_set1_ps(m->m[r][k]);
+
+    for (int i = 0; i < in->capacity; i += 8)
+    {
+        __m256 x = _mm256_load_ps(in->x + i);
+        __m256 y = _mm256_load_ps(in->y + i);
+        __m256 z = _mm256_load_ps(in->z + i);
+        __m256 w = _mm256_load_ps(in->w + i);
+        float *dst[4] = {out->x + i, out->y + i, out->z + i, out->w + i};
+        for (int r = 0; r < 4; r++)
+        {
+            __m256 v = _mm256_add_ps(_mm256_mul_ps(c[r][0], x), _mm256_mul_ps(c[r][1], y));
+            v = _mm256_add_ps(v, _mm256_mul_ps(c[r][2], z));
+            v = _mm256_add_ps(v, _mm256_mul_ps(c[r][3], w));
+            _mm256_store_ps(dst[r], v);
+        }
+    }
+}
+
+SIMD_TARGET_AVX512
+static void transform_avx512(const VertexStream *in, VertexStream *out, const Mat4 *m)
+{
+    __m512 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm512_set1_ps(m->m[r][k]);
+
+    // arena alignment is 32 so these loads are unaligned
+    for (int i = 0; i < in->capacity; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in->x + i);
+        __m512 y = _mm512_loadu_ps(in->y + i);
+        __m512 z = _mm512_loadu_ps(in->z + i);
+        __m512 w = _mm512_loadu_ps(in->w + i);
+        float *dst[4] = {out->x + i, out->y + i, out->z + i, out->w + i};
+        for (int r = 0; r < 4; r++)
+        {
+            __m512 v = _mm512_add_ps(_mm512_mul_ps(c[r][0], x), _mm512_mul_ps(c[r][1], y));
+            v = _mm512_add_ps(v, _mm512_mul_ps(c[r][2], z));
+            v = _mm512_add_ps(v, _mm512_mul_ps(c[r][3], w));
+            _mm512_storeu_ps(dst[r], v);
+        }
+    }
+}
+
+static void project_sse2(const VertexStream *in, const Mat4 *m, float width, float height, float *screen, float *inv_w, uint8_t *outcodes)
+{
+    __m128 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm_set1_ps(m->m[r][k]);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 w_scale = _mm_set1_ps(width);
+    const __m128 h_scale = _mm_set1_ps(height);
+    const __m128 guard_band = _mm_set1_ps(CLIP_GUARD_BAND);
+
+    _Alignas(16) float sx[4], sy[4], sz[4];
+    for (int i = 0; i < in->capacity; i += 4)
+    {
+        __m128 x = _mm_load_ps(in->x + i);
+        __m128 y = _mm_load_ps(in->y + i);
+        __m128 z = _mm_load_ps(in->z + i);
+        __m128 w = _mm_load_ps(in->w + i);
+        __m128 clip[4];
+        for (int r = 0; r < 4; r++)
+        {
+            __m128 v = _mm_add_ps(_mm_mul_ps(c[r][0], x), _mm_mul_ps(c[r][1], y));
+            v = _mm_add_ps(v, _mm_mul_ps(c[r][2], z));
+            clip[r] = _mm_add_ps(v, _mm_mul_ps(c[r][3], w));
+        }
+
+        __m128 neg_w = _mm_xor_ps(clip[3], sign);
+        __m128 guard = _mm_mul_ps(guard_band, clip[3]);
+        __m128 neg_guard = _mm_xor_ps(guard, sign);
+        __m128 outside_guard = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(clip[0], neg_guard), _mm_cmpgt_ps(clip[0], guard)),
+                                         _mm_or_ps(_mm_cmplt_ps(clip[1], neg_guard), _mm_cmpgt_ps(clip[1], guard)));
+        unsigned masks[6] = {
+            (unsigned)_mm_movemask_ps(_mm_cmplt_ps(clip[0], neg_w)),
+            (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(clip[0], clip[3])),
+            (unsigned)_mm_movemask_ps(_mm_cmplt_ps(clip[1], neg_w)),
+            (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(clip[1], clip[3])),
+            (unsigned)_mm_movemask_ps(_mm_cmplt_ps(clip[2], neg_w)),
+            (unsigned)_mm_movemask_ps(outside_guard),
+        };
+
+        // lanes with w == 0 divide by zero here and get masked back out
+        __m128 nonzero = _mm_cmpneq_ps(clip[3], zero);
+        _mm_store_ps(inv_w + i, _mm_and_ps(nonzero, _mm_div_ps(one, clip[3])));
+        __m128 nx = _mm_or_ps(_mm_and_ps(nonzero, _mm_div_ps(clip[0], clip[3])), _mm_andnot_ps(nonzero, clip[0]));
+        __m128 ny = _mm_or_ps(_mm_and_ps(nonzero, _mm_div_ps(clip[1], clip[3])), _mm_andnot_ps(nonzero, clip[1]));
+        _mm_store_ps(sx, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(nx, half), half), w_scale));
+        _mm_store_ps(sy, _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(_mm_mul_ps(ny, half), half)), h_scale));
+        _mm_store_ps(sz, clip[2]);
+        store_lanes(4, i, in->count, sx, sy, sz, masks, screen, outcodes);
+    }
+}
+
+SIMD_TARGET_AVX2
+static void project_avx2(const VertexStream *in, const Mat4 *m, float width, float height, float *screen, float *inv_w, uint8_t *outcodes)
+{
+    __m256 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm256_set1_ps(m->m[r][k]);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 w_scale = _mm256_set1_ps(width);
+    const __m256 h_scale = _mm256_set1_ps(height);
+    const __m256 guard_band = _mm256_set1_ps(CLIP_GUARD_BAND);
+
+    _Alignas(32) float sx[8], sy[8], sz[8];
+    for (int i = 0; i < in->capacity; i += 8)
+    {
+        __m256 x = _mm256_load_ps(in->x + i);
+        __m256 y = _mm256_load_ps(in->y + i);
+        __m256 z = _mm256_load_ps(in->z + i);
+        __m256 w = _mm256_load_ps(in->w + i);
+        __m256 clip[4];
+        for (int r = 0; r < 4; r++)
+        {
+            __m256 v = _mm256_add_ps(_mm256_mul_ps(c[r][0], x), _mm256_mul_ps(c[r][1], y));
+            v = _mm256_add_ps(v, _mm256_mul_ps(c[r][2], z));
+            clip[r] = _mm256_add_ps(v, _mm256_mul_ps(c[r][3], w));
+        }
+
+        __m256 neg_w = _mm256_xor_ps(clip[3], sign);
+        __m256 guard = _mm256_mul_ps(guard_band, clip[3]);
+        __m256 neg_guard = _mm256_xor_ps(guard, sign);
+        __m256 outside_guard = _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(clip[0], neg_guard, _CMP_LT_OQ), _mm256_cmp_ps(clip[0], guard, _CMP_GT_OQ)),
+            _mm256_or_ps(_mm256_cmp_ps(clip[1], neg_guard, _CMP_LT_OQ), _mm256_cmp_ps(clip[1], guard, _CMP_GT_OQ)));
+        unsigned masks[6] = {
+            (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(clip[0], neg_w, _CMP_LT_OQ)),
+            (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(clip[0], clip[3], _CMP_GT_OQ)),
+            (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(clip[1], neg_w, _CMP_LT_OQ)),
+            (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(clip[1], clip[3], _CMP_GT_OQ)),
+            (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(clip[2], neg_w, _CMP_LT_OQ)),
+            (unsigned)_mm256_movemask_ps(outside_guard),
+        };
+
+        __m256 nonzero = _mm256_cmp_ps(clip[3], zero, _CMP_NEQ_UQ);
+        _mm256_store_ps(inv_w + i, _mm256_and_ps(nonzero, _mm256_div_ps(one, clip[3])));
+        __m256 nx = _mm256_blendv_ps(clip[0], _mm256_div_ps(clip[0], clip[3]), nonzero);
+        __m256 ny = _mm256_blendv_ps(clip[1], _mm256_div_ps(clip[1], clip[3]), nonzero);
+        _mm256_store_ps(sx, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(nx, half), half), w_scale));
+        _mm256_store_ps(sy, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(_mm256_mul_ps(ny, half), half)), h_scale));
+        _mm256_store_ps(sz, clip[2]);
+        store_lanes(8, i, in->count, sx, sy, sz, masks, screen, outcodes);
+    }
+}
+
+SIMD_TARGET_AVX512
+static void project_avx512(const VertexStream *in, const Mat4 *m, float width, float height, float *screen, float *inv_w, uint8_t *outcodes)
+{
+    __m512 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++)
+            c[r][k] = _mm512_set1_ps(m->m[r][k]);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 w_scale = _mm512_set1_ps(width);
+    const __m512 h_scale = _mm512_set1_ps(height);
+    const __m512 guard_band = _mm512_set1_ps(CLIP_GUARD_BAND);
+
+    _Alignas(64) float sx[16], sy[16], sz[16];
+    for (int i = 0; i < in->capacity; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in->x + i);
+        __m512 y = _mm512_loadu_ps(in->y + i);
+        __m512 z = _mm512_loadu_ps(in->z + i);
+        __m512 w = _mm512_loadu_ps(in->w + i);
+        __m512 clip[4];
+        for (int r = 0; r < 4; r++)
+        {
+            __m512 v = _mm512_add_ps(_mm512_mul_ps(c[r][0], x), _mm512_mul_ps(c[r][1], y));
+            v = _mm512_add_ps(v, _mm512_mul_ps(c[r][2], z));
+            clip[r] = _mm512_add_ps(v, _mm512_mul_ps(c[r][3], w));
+        }
+
+        __m512 neg_w = _mm512_sub_ps(zero, clip[3]);
+        __m512 guard = _mm512_mul_ps(guard_band, clip[3]);
+        __m512 neg_guard = _mm512_sub_ps(zero, guard);
+        __mmask16 outside_guard = _mm512_cmp_ps_mask(clip[0], neg_guard, _CMP_LT_OQ) |
+                                  _mm512_cmp_ps_mask(clip[0], guard, _CMP_GT_OQ) |
+                                  _mm512_cmp_ps_mask(clip[1], neg_guard, _CMP_LT_OQ) |
+                                  _mm512_cmp_ps_mask(clip[1], guard, _CMP_GT_OQ);
+        unsigned masks[6] = {
+            (unsigned)_mm512_cmp_ps_mask(clip[0], neg_w, _CMP_LT_OQ),
+            (unsigned)_mm512_cmp_ps_mask(clip[0], clip[3], _CMP_GT_OQ),
+            (unsigned)_mm512_cmp_ps_mask(clip[1], neg_w, _CMP_LT_OQ),
+            (unsigned)_mm512_cmp_ps_mask(clip[1], clip[3], _CMP_GT_OQ),
+            (unsigned)_mm512_cmp_ps_mask(clip[2], neg_w, _CMP_LT_OQ),
+            (unsigned)outside_guard,
+        };
+
+        __mmask16 nonzero = _mm512_cmp_ps_mask(clip[3], zero, _CMP_NEQ_UQ);
+        _mm512_storeu_ps(inv_w + i, _mm512_maskz_div_ps(nonzero, one, clip[3]));
+        __m512 nx = _mm512_mask_div_ps(clip[0], nonzero, clip[0], clip[3]);
+        __m512 ny = _mm512_mask_div_ps(clip[1], nonzero, clip[1], clip[3]);
+        _mm512_store_ps(sx, _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(nx, half), half), w_scale));
+        _mm512_store_ps(sy, _mm512_mul_ps(_mm512_sub_ps(one, _mm512_add_ps(_mm512_mul_ps(ny, half), half)), h_scale));
+        _mm512_store_ps(sz, clip[2]);
+        store_lanes(16, i, in->count, sx, sy, sz, masks, screen, outcodes);
+    }
+}
+
+#endif // SIMD_X86
+
+void vertex_stream_transform(const VertexStream *in, VertexStream *out, const Mat4 *m)
+{
+    out->count = in->count;
+#if SIMD_X86
+    switch (simd_level())
+    {
+    case SIMD_LEVEL_AVX512:
+        transform_avx512(in, out, m);
+        return;
+    case SIMD_LEVEL_AVX2:
+        transform_avx2(in, out, m);
+        return;
+    case SIMD_LEVEL_SSE2:
+        transform_sse2(in, out, m);
+        return;
+    default:
+        break;
+    }
+#endif
+    transform_scalar(in, out, m);
+}
+
+void vertex_stream_project(
+    const VertexStream *in,
+    const Mat4 *mvp,
+    int screen_width,
+    int screen_height,
+    float *screen,
+    float *inv_w,
+    uint8_t *outcodes)
+{
+    float width = (float)screen_width;
+    float height = (float)screen_height;
+#if SIMD_X86
+    switch (simd_level())
+    {
+    case SIMD_LEVEL_AVX512:
+        project_avx512(in, mvp, width, height, screen, inv_w, outcodes);
+        return;
+    case SIMD_LEVEL_AVX2:
+        project_avx2(in, mvp, width, height, screen, inv_w, outcodes);
+        return;
+    case SIMD_LEVEL_SSE2:
+        project_sse2(in, mvp, width, height, screen, inv_w, outcodes);
+        return;
+    default:
+        break;
+    }
+#endif
+    project_scalar(in, mvp, width, height, screen, inv_w, outcodes);
+}
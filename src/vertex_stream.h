@@ -0,0 +1,69 @@
+#ifndef VERTEX_STREAM_H
+#define VERTEX_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sfa.h"
+#include "mat4.h"
+#include "arena.h"
+
+/*
+    Vertex positions stored as separate x, y, z, w arrays (structure of arrays),
+    so the transform kernel can load 4/8/16 vertices of one component in a single register.
+    Arrays are ARENA_ALIGN aligned and padded to VERTEX_STREAM_PAD with zeroed vertices,
+    kernels run over the whole padded capacity and never need a scalar tail.
+*/
+
+#define VERTEX_STREAM_PAD 16 // widest kernel (avx-512) does 16 vertices per step
+
+// clip space outcodes, a bit is set when the vertex is outside that plane.
+// there is no far bit, the scenes are drawn well past the projection's far distance
+#define CLIP_LEFT 0x01   // x < -w
+#define CLIP_RIGHT 0x02  // x > w
+#define CLIP_BOTTOM 0x04 // y < -w
+#define CLIP_TOP 0x08    // y > w
+#define CLIP_NEAR 0x10   // z < -w
+#define CLIP_OUTSIDE (CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP | CLIP_NEAR)
+// outside the guard band on any side, |x| or |y| > CLIP_GUARD_BAND * w.
+// not a plane, so it must not take part in the all-outside test
+#define CLIP_GUARD 0x20
+
+// how far past the screen edges (in screen sizes from the center) triangles get rasterized unclipped,
+// the scissor in the rasterizer throws the extra away. keeps coordinates small enough for the edge math
+#define CLIP_GUARD_BAND 4.0f
+
+typedef struct
+{
+    int count;    // real vertices
+    int capacity; // count rounded up to VERTEX_STREAM_PAD
+    float *x;
+    float *y;
+    float *z;
+    float *w;
+} VertexStream;
+
+// lives in the arena until it is reset, a NULL arena means the heap and vertex_stream_free.
+// only the padding is zeroed, the first count vertices are left for the caller to fill
+VertexStream *vertex_stream_new_in(Arena *arena, int count);
+void vertex_stream_free(VertexStream *vs);
+// x y z x y z sfa -> stream with w = 1
+VertexStream *vertex_stream_from_sfa_in(Arena *arena, const SFA *xyz);
+
+// out = m * in for every vertex, out needs at least in->capacity.
+// same multiply/add order as mat4_multiply_vec4 so every simd level gives the same bits
+void vertex_stream_transform(const VertexStream *in, VertexStream *out, const Mat4 *m);
+
+// object space straight to the screen in one pass, the clip space vertices never hit memory.
+// screen gets x y depth per vertex (in->count of them), depth is clip z like map_to_screen_keep_z.
+// inv_w (1 / clip w, 0 where w is 0) and outcodes need room for in->capacity entries
+void vertex_stream_project(
+    const VertexStream *in,
+    const Mat4 *mvp,
+    int screen_width,
+    int screen_height,
+    float *screen,
+    float *inv_w,
+    uint8_t *outcodes);
+
+#endif // VERTEX_STREAM_H
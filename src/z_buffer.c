@@ -1,41 +1,32 @@
-#include "f_texture.h"
+#include "depth_buffer.h"
 #include "texture.h"
 #include "colors.h"
 #include "utils.h"
 #include "draw_lib.h"
+#include "z_buffer.h"
 
-void debug_draw_z_buffer(Texture *pb, FTexture *z_buffer)
+// gray by depth, 500 and past is white
+static uint32_t depth_color(float z)
 {
-    // get min and max z
-    float min_z = FLT_MAX;
-    float max_z = -FLT_MAX;
-    for (int i = 0; i < z_buffer->width * z_buffer->height; i++)
-    {
-        float z = z_buffer->data[i];
-        if (z < min_z)
-        {
-            min_z = z;
-        }
-        if (z > max_z)
-        {
-            max_z = z;
-        }
-    }
+    z /= 500.0f;
+    z = z < 0.0f ? 0.0f : (z > 1.0f ? 1.0f : z);
+    uint8_t z8 = (uint8_t)(z * 255.0f);
+    return color_from_rgb(z8, z8, z8);
+}
 
+void debug_draw_z_buffer(Texture *pb, DepthBuffer *z_buffer)
+{
     float mapscale = 4.0f;
     for (int y = 0; y < z_buffer->height; y += (int)mapscale)
     {
         for (int x = 0; x < z_buffer->width; x += (int)mapscale)
         {
-            float z = f_texture_get(z_buffer, x, y);
+            float z = depth_buffer_get(z_buffer, x, y);
             // z = map_range(z, min_z, max_z, 0.0f, 1.0f);
             // z = 1.0f - z;
             // high pow
             // z = pow(z, 1000.0f);
-            z /= 500.0f;
-            uint8_t z8 = (uint8_t)(z * 255.0f);
-            uint32_t color = color_from_rgb(z8, z8, z8);
-            texture_set(pb, x / mapscale, y / mapscale, color);
+            texture_set(pb, x / mapscale, y / mapscale, depth_color(z));
 
             // if (z < 500.0f)
             // {
@@ -48,6 +39,20 @@ void debug_draw_z_buffer(Texture *pb, FTexture *z_buffer)
     }
 }
 
+// one pixel per cell, cells no occluder covered whole stay dark red
+void debug_draw_occlusion_buffer(Texture *pb, const OcclusionBuffer *ob)
+{
+    for (int y = 0; y < ob->height && y < pb->height; y++)
+    {
+        for (int x = 0; x < ob->width && x < pb->width; x++)
+        {
+            float z = ob->depth[y * ob->width + x];
+            uint32_t color = z == FLT_MAX ? color_from_rgb(64, 0, 0) : depth_color(z);
+            texture_set(pb, x, y, color);
+        }
+    }
+}
+
 //  // debug the face buffer
 //     {
 //         // get min and max face
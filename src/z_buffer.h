@@ -0,0 +1,12 @@
+#ifndef Z_BUFFER_H
+#define Z_BUFFER_H
+
+#include "texture.h"
+#include "depth_buffer.h"
+#include "occlusion.h"
+
+// debug views, drawn over the top left corner of pb
+void debug_draw_z_buffer(Texture *pb, DepthBuffer *z_buffer);
+void debug_draw_occlusion_buffer(Texture *pb, const OcclusionBuffer *ob);
+
+#endif // Z_BUFFER_H